@@ -0,0 +1,86 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+// std
+#include <algorithm>  // sort
+#include <random>  // mt19937_64, uniform_int_distribution
+#include <string>
+#include <vector>
+// sdsl
+#include <sdsl/int_vector.hpp>  // int_vector
+
+
+using std::mt19937_64;
+using std::sort;
+using std::string;
+using std::uniform_int_distribution;
+using std::vector;
+using sdsl::int_vector;
+
+
+// Draws patterns of length m from the text that do not cross a sentinel;
+// none if the text is not longer than m
+inline vector<string> sample_patterns(const int_vector<8>& text, uint64_t m, uint64_t count)
+{
+  vector<string> patterns;
+  if (text.size() <= m) {
+    return patterns;
+  }
+  mt19937_64 rng(42);
+  uniform_int_distribution<uint64_t> start(0, text.size()-m-1);
+  for (uint64_t tries = 0; patterns.size() < count && tries < 100*count; ++tries) {
+    uint64_t i = start(rng);
+    string p;
+    for (uint64_t j = i; j < i+m && text[j] > 1; ++j) {
+      p.push_back(text[j]);
+    }
+    if (p.size() == m) {
+      patterns.emplace_back(p);
+    }
+  }
+  return patterns;
+}
+
+
+// Nearest-rank percentile q (0 < q <= 1) of sorted values
+inline double percentile(const vector<double>& sorted, double q)
+{
+  if (sorted.empty()) {
+    return 0.0;
+  }
+  uint64_t rank = (uint64_t)(q*sorted.size() + 0.999999);
+  return sorted[rank ? rank-1 : 0];
+}
+
+
+// Latencies of single operations, in microseconds
+struct latency_stats
+{
+  uint64_t operations = 0;
+  double total_us = 0.0;
+  double p50_us = 0.0;
+  double p90_us = 0.0;
+  double p99_us = 0.0;
+  double max_us = 0.0;
+
+  explicit latency_stats(vector<double> latencies = vector<double>())
+  {
+    sort(latencies.begin(), latencies.end());
+    operations = latencies.size();
+    for (const auto& l : latencies) {
+      total_us += l;
+    }
+    p50_us = percentile(latencies, 0.5);
+    p90_us = percentile(latencies, 0.9);
+    p99_us = percentile(latencies, 0.99);
+    max_us = latencies.empty() ? 0.0 : latencies.back();
+  }
+
+  double per_second() const
+  {
+    return total_us > 0 ? operations/(total_us/1e6) : 0.0;
+  }
+};
+
+
+#endif
@@ -0,0 +1,46 @@
+// std
+#include <iostream>  // cerr, endl
+#include <string>  // stod, stoull, string
+#include <vector>
+// local
+#include "pangenome.hpp"  // generate_pangenome, pangenome_options, write_fasta
+
+
+using std::cerr;
+using std::endl;
+using std::stod;
+using std::stoull;
+using std::string;
+using std::vector;
+
+
+// Writes a synthetic pangenome to OUTPUT, e.g.
+//   generate_pangenome pangenome.fa 1000000 16 7 0.01 0.001 0.00001
+int main(int argc, char* argv[])
+{
+  if (argc < 4 || argc > 8) {
+    cerr << "usage: " << argv[0] << " OUTPUT LENGTH GENOMES [SEED [SNP_RATE [INDEL_RATE [REARRANGEMENT_RATE]]]]" << endl;
+    return 1;
+  }
+  pangenome_options opts;
+  opts.length = stoull(argv[2]);
+  opts.genomes = stoull(argv[3]);
+  if (argc > 4) {
+    opts.seed = stoull(argv[4]);
+  }
+  if (argc > 5) {
+    opts.snp_rate = stod(argv[5]);
+  }
+  if (argc > 6) {
+    opts.indel_rate = stod(argv[6]);
+  }
+  if (argc > 7) {
+    opts.rearrangement_rate = stod(argv[7]);
+  }
+  vector<string> genomes = generate_pangenome(opts);
+  if (!write_fasta(genomes, argv[1])) {
+    cerr << "Could not write '" << argv[1] << "'." << endl;
+    return 1;
+  }
+  return 0;
+}
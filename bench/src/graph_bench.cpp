@@ -0,0 +1,405 @@
+// std
+#include <chrono>  // duration, high_resolution_clock
+#include <cstdio>  // remove
+#include <iostream>  // cerr, cout, endl, ostream
+#include <sstream>  // istringstream
+#include <string>  // getline, stod, stoull, string, to_string
+#include <tuple>  // tie
+#include <vector>
+// GNU
+#include <getopt.h>  // getopt_long, option, required_argument
+// POSIX
+#include <sys/resource.h>  // getrusage, rusage
+#include <sys/wait.h>  // waitpid, WEXITSTATUS, WIFEXITED
+#include <unistd.h>  // _exit, fork, getpid
+// sdsl
+#include <sdsl/config.hpp>  // sdsl::conf, cache_config
+#include <sdsl/int_vector.hpp>  // int_vector
+#include <sdsl/io.hpp>  // load_from_cache, size_in_bytes
+#include <sdsl/util.hpp>  // sdsl::util
+// local
+#include "bench.hpp"  // latency_stats, sample_patterns
+#include "cdbg/cdbg.hpp"  // CDBG_BV, CDBG_DNA, CDBG_RRR, CDBG_SD, node,
+                          // path_segment, profile, query_workspace
+#include "create_datastructures.hpp"  // create_bwt, create_da, create_sa,
+                                      // create_text
+#include "pangenome.hpp"  // generate_pangenome, pangenome_options, write_fasta
+
+
+using std::chrono::duration;
+using std::chrono::high_resolution_clock;
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::getline;
+using std::istringstream;
+using std::ostream;
+using std::stod;
+using std::stoull;
+using std::string;
+using std::tie;
+using std::to_string;
+using std::vector;
+using sdsl::cache_config;
+using sdsl::int_vector;
+using sdsl::load_from_cache;
+using cdbg::profile;
+
+
+struct bench_options
+{
+  vector<uint64_t> lengths = {1000000};
+  vector<uint64_t> genomes = {8};
+  vector<uint64_t> ks = {31};
+  vector<profile> profiles = {profile::bv};
+  uint64_t queries = 10000;
+  bool json = false;
+  pangenome_options pangenome;
+};
+
+
+// One configuration of the grid
+struct bench_row
+{
+  uint64_t length = 0;
+  uint64_t genomes = 0;
+  uint64_t k = 0;
+  profile graph_profile = profile::bv;
+  uint64_t text_bytes = 0;
+  double datastructures_s = 0.0;  // text, suffix array, BWT, document array
+  double graph_s = 0.0;
+  uint64_t graph_bytes = 0;
+  uint64_t nodes = 0;
+  latency_stats find_nodes;
+  latency_stats sequences_in_node;
+  latency_stats find_path;  // allocation-free, with a query_workspace
+  latency_stats copy_documents;
+  double explicit_s = 0.0;
+  uint64_t peak_rss_kib = 0;
+};
+
+
+double seconds_since(high_resolution_clock::time_point t)
+{
+  return duration<double>(high_resolution_clock::now()-t).count();
+}
+
+
+double microseconds_since(high_resolution_clock::time_point t)
+{
+  return duration<double, std::micro>(high_resolution_clock::now()-t).count();
+}
+
+
+// Builds the data structures and the graph and times the queries, all in the
+// calling process, so its peak RSS is the one of this configuration
+template<class t_cdbg>
+bench_row run(const string& fasta, uint64_t k, const bench_options& opts)
+{
+  bench_row row;
+  row.k = k;
+  cache_config config(true, ".", "graph_bench"+to_string(getpid()));
+  auto t = high_resolution_clock::now();
+  vector<uint64_t> sequences = cdbg::create_text(config, fasta, true);
+  cdbg::create_sa(config, false);
+  cdbg::create_bwt(config);
+  cdbg::create_da(config, sequences);
+  row.datastructures_s = seconds_since(t);
+  vector<string> patterns;
+  {
+    int_vector<8> text;
+    load_from_cache(text, sdsl::conf::KEY_TEXT, config);
+    row.text_bytes = text.size();
+    patterns = sample_patterns(text, k, opts.queries);
+  }
+  t = high_resolution_clock::now();
+  t_cdbg g(config, k, true, 0);
+  row.graph_s = seconds_since(t);
+  row.graph_profile = profile_of(g);
+  row.graph_bytes = sdsl::size_in_bytes(g);
+  row.nodes = g.number_of_nodes();
+  // Queries
+  vector<double> latencies;
+  vector<uint64_t> hits;
+  for (const auto& p : patterns) {
+    vector<uint64_t> nodes;
+    uint64_t offset;
+    t = high_resolution_clock::now();
+    tie(nodes, offset) = g.find_nodes(p);
+    latencies.emplace_back(microseconds_since(t));
+    if (!nodes.empty()) {
+      hits.emplace_back(nodes.front());
+    }
+  }
+  row.find_nodes = latency_stats(latencies);
+  latencies.clear();
+  for (const auto& v : hits) {
+    t = high_resolution_clock::now();
+    g.sequences_in_node(v);
+    latencies.emplace_back(microseconds_since(t));
+  }
+  row.sequences_in_node = latency_stats(latencies);
+  latencies.clear();
+  cdbg::query_workspace workspace;
+  for (const auto& p : patterns) {
+    t = high_resolution_clock::now();
+    g.find_path(p, workspace, [](const cdbg::path_segment&) { });
+    latencies.emplace_back(microseconds_since(t));
+  }
+  row.find_path = latency_stats(latencies);
+  latencies.clear();
+  vector<uint64_t> documents(sequences.size());
+  for (const auto& v : hits) {
+    t = high_resolution_clock::now();
+    g.copy_documents(v, documents.begin(), workspace);
+    latencies.emplace_back(microseconds_since(t));
+  }
+  row.copy_documents = latency_stats(latencies);
+  {
+    vector<cdbg::node> graph;
+    vector<uint64_t> start_nodes;
+    t = high_resolution_clock::now();
+    tie(graph, start_nodes) = g.get_explicit_representation();
+    row.explicit_s = seconds_since(t);
+  }
+  sdsl::util::delete_all_files(config.file_map);
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  row.peak_rss_kib = usage.ru_maxrss;
+  return row;
+}
+
+
+const char* const columns[] = {
+  "length", "genomes", "k", "profile", "text_bytes", "datastructures_s",
+  "graph_s", "graph_bytes", "nodes",
+  "find_nodes_per_s", "find_nodes_p50_us", "find_nodes_p90_us",
+  "find_nodes_p99_us", "find_nodes_max_us",
+  "sequences_in_node_per_s", "sequences_in_node_p50_us",
+  "sequences_in_node_p90_us", "sequences_in_node_p99_us",
+  "sequences_in_node_max_us",
+  "find_path_per_s", "find_path_p50_us", "find_path_p90_us",
+  "find_path_p99_us", "find_path_max_us",
+  "copy_documents_per_s", "copy_documents_p50_us", "copy_documents_p90_us",
+  "copy_documents_p99_us", "copy_documents_max_us",
+  "explicit_s", "peak_rss_kib"};
+
+
+void print_row(ostream& out, const bench_row& row, bool json)
+{
+  vector<string> values = {
+    to_string(row.length), to_string(row.genomes), to_string(row.k),
+    cdbg::profile_name(row.graph_profile), to_string(row.text_bytes),
+    to_string(row.datastructures_s), to_string(row.graph_s),
+    to_string(row.graph_bytes), to_string(row.nodes),
+    to_string(row.find_nodes.per_second()), to_string(row.find_nodes.p50_us),
+    to_string(row.find_nodes.p90_us), to_string(row.find_nodes.p99_us),
+    to_string(row.find_nodes.max_us),
+    to_string(row.sequences_in_node.per_second()),
+    to_string(row.sequences_in_node.p50_us),
+    to_string(row.sequences_in_node.p90_us),
+    to_string(row.sequences_in_node.p99_us),
+    to_string(row.sequences_in_node.max_us),
+    to_string(row.find_path.per_second()), to_string(row.find_path.p50_us),
+    to_string(row.find_path.p90_us), to_string(row.find_path.p99_us),
+    to_string(row.find_path.max_us),
+    to_string(row.copy_documents.per_second()),
+    to_string(row.copy_documents.p50_us),
+    to_string(row.copy_documents.p90_us),
+    to_string(row.copy_documents.p99_us),
+    to_string(row.copy_documents.max_us),
+    to_string(row.explicit_s), to_string(row.peak_rss_kib)};
+  for (uint64_t i = 0; i < values.size(); ++i) {
+    if (json) {
+      out << (i ? ", " : "  {") << "\"" << columns[i] << "\": ";
+      if (i == 3) {
+        out << "\"" << values[i] << "\"";
+      } else {
+        out << values[i];
+      }
+    } else {
+      out << (i ? "," : "") << values[i];
+    }
+  }
+  out << (json ? "}" : "") << endl;
+}
+
+
+template<class t_value, class t_parse>
+vector<t_value> parse_list(const string& list, t_parse parse)
+{
+  vector<t_value> values;
+  istringstream in(list);
+  string item;
+  while (getline(in, item, ',')) {
+    values.emplace_back(parse(item));
+  }
+  return values;
+}
+
+
+void usage(const string& program)
+{
+  cerr << "usage: " << program << " [options]" << endl;
+  cerr << endl;
+  cerr << "Every option taking a LIST accepts comma separated values; the grid is their product." << endl;
+  cerr << "  -n, --lengths=LIST        reference lengths (default: 1000000)" << endl;
+  cerr << "  -d, --genomes=LIST        genomes per pangenome (default: 8)" << endl;
+  cerr << "  -k, --k=LIST              k values (default: 31)" << endl;
+  cerr << "  -f, --profiles=LIST       bv, sd, rrr and/or dna (default: bv)" << endl;
+  cerr << "  -q, --queries=QUERIES     find_nodes queries of length k (default: 10000)" << endl;
+  cerr << "  -s, --seed=SEED           seed of the pangenome generator (default: 1)" << endl;
+  cerr << "  -S, --snp=RATE            SNPs per base (default: 0.01)" << endl;
+  cerr << "  -I, --indel=RATE          indels per base (default: 0.001)" << endl;
+  cerr << "  -R, --rearrangement=RATE  inversions and transpositions per base (default: 0.00001)" << endl;
+  cerr << "  -j, --json                print JSON instead of CSV" << endl;
+}
+
+
+bool parse_args(int argc, char* argv[], bench_options& opts)
+{
+  const char* const short_opts = "n:d:k:f:q:s:S:I:R:jh";
+  static struct option long_opts[] =
+  {
+    {"lengths", required_argument, nullptr, 'n'},
+    {"genomes", required_argument, nullptr, 'd'},
+    {"k", required_argument, nullptr, 'k'},
+    {"profiles", required_argument, nullptr, 'f'},
+    {"queries", required_argument, nullptr, 'q'},
+    {"seed", required_argument, nullptr, 's'},
+    {"snp", required_argument, nullptr, 'S'},
+    {"indel", required_argument, nullptr, 'I'},
+    {"rearrangement", required_argument, nullptr, 'R'},
+    {"json", no_argument, nullptr, 'j'},
+    {"help", no_argument, nullptr, 'h'},
+    {nullptr, no_argument, nullptr, 0}
+  };
+  auto to_uint = [](const string& s) { return (uint64_t)stoull(s); };
+  bool ok = true;
+  auto to_profile = [&ok](const string& s) {
+    profile p = profile::bv;
+    if (!cdbg::parse_profile(s, p)) {
+      cerr << "ERROR: Unknown profile '" << s << "'." << endl;
+      ok = false;
+    }
+    return p;
+  };
+  int64_t c;
+  while ((c = getopt_long(argc, argv, short_opts, long_opts, nullptr)) != -1) {
+    switch (c) {
+      case 'n':
+        opts.lengths = parse_list<uint64_t>(optarg, to_uint);
+        break;
+      case 'd':
+        opts.genomes = parse_list<uint64_t>(optarg, to_uint);
+        break;
+      case 'k':
+        opts.ks = parse_list<uint64_t>(optarg, to_uint);
+        break;
+      case 'f':
+        opts.profiles = parse_list<profile>(optarg, to_profile);
+        break;
+      case 'q':
+        opts.queries = stoull(optarg);
+        break;
+      case 's':
+        opts.pangenome.seed = stoull(optarg);
+        break;
+      case 'S':
+        opts.pangenome.snp_rate = stod(optarg);
+        break;
+      case 'I':
+        opts.pangenome.indel_rate = stod(optarg);
+        break;
+      case 'R':
+        opts.pangenome.rearrangement_rate = stod(optarg);
+        break;
+      case 'j':
+        opts.json = true;
+        break;
+      default:
+        return false;
+    }
+  }
+  return ok;
+}
+
+
+// Measures every configuration of the grid in a child process of its own and
+// prints one CSV line (or JSON object) per configuration, e.g.
+//   graph_bench --lengths=1000000,4000000 --genomes=4,16 --k=15,31 --profiles=bv,sd,rrr
+int main(int argc, char* argv[])
+{
+  bench_options opts;
+  if (!parse_args(argc, argv, opts)) {
+    usage(argv[0]);
+    return 1;
+  }
+  if (opts.json) {
+    cout << "[" << endl;
+  } else {
+    for (uint64_t i = 0; i < sizeof(columns)/sizeof(columns[0]); ++i) {
+      cout << (i ? "," : "") << columns[i];
+    }
+    cout << endl;
+  }
+  bool first = true;
+  bool ok = true;
+  for (const auto& length : opts.lengths) {
+    for (const auto& genomes : opts.genomes) {
+      pangenome_options pangenome = opts.pangenome;
+      pangenome.length = length;
+      pangenome.genomes = genomes;
+      string fasta = "graph_bench"+to_string(getpid())+".fa";
+      if (!write_fasta(generate_pangenome(pangenome), fasta)) {
+        cerr << "Could not write '" << fasta << "'." << endl;
+        return 1;
+      }
+      for (const auto& k : opts.ks) {
+        for (const auto& p : opts.profiles) {
+          cout.flush();
+          pid_t pid = fork();
+          if (pid == 0) {
+            bench_row row;
+            switch (p) {
+              case profile::sd:
+                row = run<cdbg::CDBG_SD>(fasta, k, opts);
+                break;
+              case profile::rrr:
+                row = run<cdbg::CDBG_RRR>(fasta, k, opts);
+                break;
+              case profile::dna:
+                row = run<cdbg::CDBG_DNA>(fasta, k, opts);
+                break;
+              default:
+                row = run<cdbg::CDBG_BV>(fasta, k, opts);
+                break;
+            }
+            row.length = length;
+            row.genomes = genomes;
+            if (opts.json && !first) {
+              cout << "," << endl;
+            }
+            print_row(cout, row, opts.json);
+            cout.flush();
+            _exit(0);
+          }
+          int status = 0;
+          if (pid < 0 || waitpid(pid, &status, 0) < 0 ||
+              !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            cerr << "Configuration length=" << length << " genomes=" << genomes;
+            cerr << " k=" << k << " profile=" << cdbg::profile_name(p) << " failed." << endl;
+            ok = false;
+          } else {
+            first = false;
+          }
+        }
+      }
+      std::remove(fasta.c_str());
+    }
+  }
+  if (opts.json) {
+    cout << "]" << endl;
+  }
+  return ok ? 0 : 1;
+}
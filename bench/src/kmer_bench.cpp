@@ -0,0 +1,119 @@
+// std
+#include <chrono>  // duration, high_resolution_clock
+#include <iostream>  // cerr, cout, endl
+#include <random>  // mt19937_64
+#include <string>  // stoull, string
+#include <tuple>  // tie
+#include <vector>
+// sdsl
+#include <sdsl/int_vector.hpp>  // int_vector
+#include <sdsl/io.hpp>  // size_in_bytes
+// local
+#include "bench.hpp"  // sample_patterns
+#include "cdbg/io/implicit_stream.hpp"  // load_implicit
+#include "cdbg/kmer_index.hpp"  // kmer_index
+
+
+using std::chrono::duration;
+using std::chrono::high_resolution_clock;
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::mt19937_64;
+using std::stoull;
+using std::string;
+using std::tie;
+using std::vector;
+using sdsl::int_vector;
+using cdbg::kmer_index;
+
+
+// Seconds fn takes for every pattern, and the patterns it finds
+template<class t_fn>
+double measure(const vector<string>& patterns, uint64_t& found, t_fn fn)
+{
+  found = 0;
+  auto t1 = high_resolution_clock::now();
+  for (const auto& p : patterns) {
+    found += fn(p);
+  }
+  auto t2 = high_resolution_clock::now();
+  return duration<double>(t2-t1).count();
+}
+
+
+struct kmer_command
+{
+  uint64_t count;
+  uint64_t fingerprint_bits;
+  uint64_t threads;
+
+  template<class t_cdbg>
+  bool operator()(const t_cdbg& g) const
+  {
+    uint64_t k = g.get_k();
+    string text;
+    for (const auto& sentinel : g.sequence_sentinels()) {
+      text += g.extract_sequence(sentinel);
+      text.push_back(1);
+    }
+    int_vector<8> t(text.size());
+    for (uint64_t i = 0; i < text.size(); ++i) {
+      t[i] = (uint8_t)text[i];
+    }
+    vector<string> present = sample_patterns(t, k, count);
+    vector<string> random;
+    mt19937_64 rng(42);
+    for (uint64_t i = 0; i < count; ++i) {
+      string p;
+      for (uint64_t j = 0; j < k; ++j) {
+        p.push_back("ACGT"[rng()%4]);
+      }
+      random.emplace_back(p);
+    }
+    auto t1 = high_resolution_clock::now();
+    kmer_index index = g.get_kmer_index(fingerprint_bits, threads);
+    auto t2 = high_resolution_clock::now();
+    double build = duration<double>(t2-t1).count();
+    cout << "queries\tmethod\tfound\tseconds\tqueries_per_s" << endl;
+    for (const auto* patterns : {&present, &random}) {
+      const char* name = (patterns == &present) ? "present" : "random";
+      uint64_t found;
+      double seconds = measure(*patterns, found, [&](const string& p) {
+        vector<uint64_t> nodes;
+        uint64_t offset;
+        tie(nodes, offset) = g.find_nodes(p);
+        return !nodes.empty();
+      });
+      cout << name << "\tfind_nodes\t" << found << "\t" << seconds << "\t";
+      cout << (seconds > 0 ? patterns->size()/seconds : 0.0) << endl;
+      seconds = measure(*patterns, found, [&](const string& p) {
+        uint64_t node;
+        uint64_t offset;
+        return index.find(p.data(), node, offset);
+      });
+      cout << name << "\tkmer_index\t" << found << "\t" << seconds << "\t";
+      cout << (seconds > 0 ? patterns->size()/seconds : 0.0) << endl;
+    }
+    cerr << index.kmers() << " kmers indexed in " << build << " s, ";
+    cerr << sdsl::size_in_bytes(index) << " bytes." << endl;
+    return true;
+  }
+};
+
+
+// Compares find_nodes with the kmer index on kmers drawn from the sequences
+// of the graph and on random kmers, e.g.
+//   kmer_bench example.k31.bin 1000000 16 4
+int main(int argc, char* argv[])
+{
+  if (argc < 3) {
+    cerr << "usage: " << argv[0] << " GRAPH QUERIES [BITS [THREADS]]" << endl;
+    return 1;
+  }
+  string graphfile = argv[1];
+  uint64_t queries = stoull(argv[2]);
+  uint64_t bits = (argc > 3) ? stoull(argv[3]) : 16;
+  uint64_t threads = (argc > 4) ? stoull(argv[4]) : 1;
+  return cdbg::io::load_implicit(graphfile, kmer_command{queries, bits, threads}) ? 0 : 1;
+}
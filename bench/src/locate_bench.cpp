@@ -0,0 +1,74 @@
+// std
+#include <chrono>  // duration_cast, high_resolution_clock, microseconds
+#include <iostream>  // cerr, cout, endl
+#include <string>  // stoull, string
+#include <vector>
+// sdsl
+#include <sdsl/config.hpp>  // sdsl::conf, cache_config
+#include <sdsl/int_vector.hpp>  // int_vector
+#include <sdsl/io.hpp>  // load_from_cache, serialize
+#include <sdsl/util.hpp>  // sdsl::util
+// local
+#include "bench.hpp"  // sample_patterns
+#include "cdbg/cdbg.hpp"  // CDBG
+#include "create_datastructures.hpp"  // create_bwt, create_sa, create_text
+
+
+using std::chrono::duration_cast;
+using std::chrono::high_resolution_clock;
+using std::chrono::microseconds;
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::stoull;
+using std::string;
+using std::vector;
+using sdsl::cache_config;
+using sdsl::int_vector;
+using sdsl::load_from_cache;
+using cdbg::CDBG;
+
+
+// Builds the graph of INPUT for k once per sampling rate and reports its
+// size and the time to locate random patterns of the given length, e.g.
+//   locate_bench input.fa 31 20 10000 4 16 64 256
+int main(int argc, char* argv[])
+{
+  if (argc < 6) {
+    cerr << "usage: " << argv[0] << " INPUT K PATTERN_LENGTH PATTERNS RATE..." << endl;
+    return 1;
+  }
+  string inputfile = argv[1];
+  uint64_t k = stoull(argv[2]);
+  uint64_t m = stoull(argv[3]);
+  uint64_t count = stoull(argv[4]);
+  cache_config config(true, ".", "locate_bench");
+  cdbg::create_text(config, inputfile, false);
+  cdbg::create_sa(config, false);
+  cdbg::create_bwt(config);
+  vector<string> patterns;
+  {
+    int_vector<8> text;
+    load_from_cache(text, sdsl::conf::KEY_TEXT, config);
+    patterns = sample_patterns(text, m, count);
+  }
+  cout << "rate\tgraph_bytes\tpatterns\toccurrences\ttotal_us\tus_per_occurrence" << endl;
+  for (int a = 5; a < argc; ++a) {
+    uint64_t rate = stoull(argv[a]);
+    CDBG g(config, k, false, rate);
+    uint64_t occurrences = 0;
+    auto t1 = high_resolution_clock::now();
+    for (const auto& p : patterns) {
+      occurrences += g.locate(p).size();
+    }
+    auto t2 = high_resolution_clock::now();
+    uint64_t us = duration_cast<microseconds>(t2-t1).count();
+    cout << rate << "\t" << sdsl::size_in_bytes(g) << "\t" << patterns.size();
+    cout << "\t" << occurrences << "\t" << us << "\t";
+    cout << (occurrences ? (double)us/occurrences : 0.0) << endl;
+  }
+  if (config.delete_files) {
+    sdsl::util::delete_all_files(config.file_map);
+  }
+  return 0;
+}
@@ -0,0 +1,196 @@
+// std
+#include <chrono>  // duration, high_resolution_clock
+#include <iostream>  // cerr, cout, endl
+#include <string>  // stoull, string
+#include <thread>  // thread
+#include <tuple>  // tie
+#include <vector>
+// POSIX
+#include <sys/resource.h>  // getrusage, rusage
+#include <sys/wait.h>  // waitpid, WEXITSTATUS, WIFEXITED
+#include <unistd.h>  // _exit, fork
+// sdsl
+#include <sdsl/int_vector.hpp>  // int_vector
+// local
+#include "bench.hpp"  // sample_patterns
+#include "cdbg/cdbg.hpp"  // CDBG_BV, CDBG_DNA, CDBG_RRR, CDBG_SD, profile
+#include "cdbg/io/implicit_stream.hpp"  // load_implicit, read_profile
+#include "cdbg/placement.hpp"  // numa_replicas, page_mode, parse_page_mode
+
+
+using std::chrono::duration;
+using std::chrono::high_resolution_clock;
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::stoull;
+using std::string;
+using std::thread;
+using std::tie;
+using std::vector;
+using sdsl::int_vector;
+using cdbg::numa_replicas;
+using cdbg::page_mode;
+using cdbg::profile;
+
+
+// A page mode, optionally with one copy of the graph per NUMA node
+struct placement
+{
+  page_mode pages = page_mode::normal;
+  bool replicate = false;
+};
+
+
+bool parse_placement(const string& name, placement& p)
+{
+  string pages = name;
+  auto plus = name.find('+');
+  if (plus != string::npos) {
+    if (name.substr(plus+1) != "replicate") {
+      return false;
+    }
+    pages = name.substr(0, plus);
+    p.replicate = true;
+  }
+  return cdbg::parse_page_mode(pages, p.pages);
+}
+
+
+// Draws the patterns from the sequences spelled by the graph
+struct sample_command
+{
+  uint64_t count;
+  vector<string>& patterns;
+
+  template<class t_cdbg>
+  bool operator()(const t_cdbg& g) const
+  {
+    string text;
+    for (const auto& sentinel : g.sequence_sentinels()) {
+      text += g.extract_sequence(sentinel);
+      text.push_back(1);
+    }
+    int_vector<8> t(text.size());
+    for (uint64_t i = 0; i < text.size(); ++i) {
+      t[i] = (uint8_t)text[i];
+    }
+    patterns = sample_patterns(t, g.get_k(), count);
+    return !patterns.empty();
+  }
+};
+
+
+// Loads the graph as placed by p and runs the patterns on threads threads;
+// prints one line
+template<class t_cdbg>
+bool run(
+  const string& graphfile,
+  const placement& p,
+  const vector<string>& patterns,
+  uint64_t threads)
+{
+  numa_replicas<t_cdbg> replicas;
+  if (!replicas.load(graphfile, p.replicate, p.pages)) {
+    return false;
+  }
+  vector<uint64_t> found(threads, 0);
+  auto t1 = high_resolution_clock::now();
+  vector<thread> workers;
+  for (uint64_t t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t]() {
+      const t_cdbg& g = replicas.bind_worker(t);
+      for (uint64_t i = t; i < patterns.size(); i += threads) {
+        vector<uint64_t> nodes;
+        uint64_t offset;
+        tie(nodes, offset) = g.find_nodes(patterns[i]);
+        found[t] += !nodes.empty();
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  auto t2 = high_resolution_clock::now();
+  double seconds = duration<double>(t2-t1).count();
+  uint64_t total = 0;
+  for (const auto& f : found) {
+    total += f;
+  }
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  cout << cdbg::page_mode_name(p.pages) << (p.replicate ? "+replicate" : "");
+  cout << "\t" << replicas.numa_nodes() << "\t" << replicas.copies() << "\t";
+  cout << threads << "\t" << patterns.size() << "\t" << total << "\t";
+  cout << seconds << "\t" << (seconds > 0 ? patterns.size()/seconds : 0.0) << "\t";
+  cout << usage.ru_maxrss << endl;
+  return true;
+}
+
+
+// Measures the find_nodes throughput of threads query threads on the graph
+// in GRAPH for every placement, each in a child process of its own, e.g.
+//   numa_bench example.k31.bin 1000000 32 normal transparent normal+replicate transparent+replicate
+int main(int argc, char* argv[])
+{
+  if (argc < 5) {
+    cerr << "usage: " << argv[0] << " GRAPH QUERIES THREADS PLACEMENT..." << endl;
+    cerr << "PLACEMENT is normal, transparent or huge (pages), optionally followed by" << endl;
+    cerr << "+replicate for one copy of the graph per NUMA node." << endl;
+    return 1;
+  }
+  string graphfile = argv[1];
+  uint64_t queries = stoull(argv[2]);
+  uint64_t threads = stoull(argv[3]);
+  vector<placement> placements;
+  for (int a = 4; a < argc; ++a) {
+    placement p;
+    if (!parse_placement(argv[a], p)) {
+      cerr << "ERROR: Unknown placement '" << argv[a] << "'." << endl;
+      return 1;
+    }
+    placements.emplace_back(p);
+  }
+  profile graph_profile;
+  if (!cdbg::io::read_profile(graphfile, graph_profile)) {
+    return 1;
+  }
+  vector<string> patterns;
+  if (!cdbg::io::load_implicit(graphfile, sample_command{queries, patterns})) {
+    cerr << "Could not draw patterns from '" << graphfile << "'." << endl;
+    return 1;
+  }
+  cout << "placement\tnuma_nodes\tcopies\tthreads\tqueries\tfound\tseconds\tqueries_per_s\tpeak_rss_kib" << endl;
+  bool ok = true;
+  for (const auto& p : placements) {
+    cout.flush();
+    pid_t pid = fork();
+    if (pid == 0) {
+      bool done;
+      switch (graph_profile) {
+        case profile::sd:
+          done = run<cdbg::CDBG_SD>(graphfile, p, patterns, threads);
+          break;
+        case profile::rrr:
+          done = run<cdbg::CDBG_RRR>(graphfile, p, patterns, threads);
+          break;
+        case profile::dna:
+          done = run<cdbg::CDBG_DNA>(graphfile, p, patterns, threads);
+          break;
+        default:
+          done = run<cdbg::CDBG_BV>(graphfile, p, patterns, threads);
+          break;
+      }
+      cout.flush();
+      _exit(done ? 0 : 1);
+    }
+    int status = 0;
+    if (pid < 0 || waitpid(pid, &status, 0) < 0 ||
+        !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      cerr << "Placement " << cdbg::page_mode_name(p.pages);
+      cerr << (p.replicate ? "+replicate" : "") << " failed." << endl;
+      ok = false;
+    }
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,169 @@
+#ifndef PANGENOME_HPP
+#define PANGENOME_HPP
+
+// std
+#include <algorithm>  // min, reverse
+#include <fstream>  // ofstream
+#include <random>  // mt19937_64
+#include <string>
+#include <vector>
+
+
+using std::min;
+using std::mt19937_64;
+using std::ofstream;
+using std::reverse;
+using std::string;
+using std::vector;
+
+
+// Mutation rates are per reference base
+struct pangenome_options
+{
+  uint64_t length = 1000000;  // of the reference
+  uint64_t genomes = 8;  // the reference and genomes-1 mutated copies
+  uint64_t seed = 1;
+  double snp_rate = 0.01;
+  double indel_rate = 0.001;
+  double rearrangement_rate = 0.00001;
+  uint64_t max_indel = 10;
+  uint64_t max_segment = 10000;  // length of inverted or moved segments
+};
+
+
+// Draws from mt19937_64 only, whose output the standard fixes, so a seed
+// gives the same pangenome with every compiler and standard library
+class pangenome_random
+{
+  private:
+    mt19937_64 m_rng;
+
+  public:
+    explicit pangenome_random(uint64_t seed) : m_rng(seed) { }
+
+    // Uniform in [0, n)
+    uint64_t below(uint64_t n)
+    {
+      return m_rng() % n;
+    }
+
+    // Uniform in [0, 1)
+    double real()
+    {
+      return (m_rng() >> 11) / 9007199254740992.0;
+    }
+
+    char base()
+    {
+      return "ACGT"[below(4)];
+    }
+
+    char other_base(char c)
+    {
+      char b = base();
+      while (b == c) {
+        b = base();
+      }
+      return b;
+    }
+};
+
+
+inline char complement(char c)
+{
+  switch (c) {
+    case 'A': return 'T';
+    case 'C': return 'G';
+    case 'G': return 'C';
+    default: return 'A';
+  }
+}
+
+
+// SNPs and indels in one pass over the reference
+inline string mutate_locally(const string& reference, const pangenome_options& opts, pangenome_random& rnd)
+{
+  string genome;
+  genome.reserve(reference.size() + reference.size()/10);
+  for (uint64_t i = 0; i < reference.size(); ++i) {
+    double r = rnd.real();
+    if (r < opts.snp_rate) {
+      genome.push_back(rnd.other_base(reference[i]));
+    } else if (r < opts.snp_rate + opts.indel_rate) {
+      uint64_t len = 1 + rnd.below(opts.max_indel);
+      if (rnd.below(2)) {
+        for (uint64_t j = 0; j < len; ++j) {
+          genome.push_back(rnd.base());
+        }
+        genome.push_back(reference[i]);
+      } else {
+        i += len-1;  // deletion of reference[i, i+len)
+      }
+    } else {
+      genome.push_back(reference[i]);
+    }
+  }
+  return genome;
+}
+
+
+// Inversions (reverse complements) and transpositions of random segments
+inline void rearrange(string& genome, uint64_t events, const pangenome_options& opts, pangenome_random& rnd)
+{
+  for (uint64_t e = 0; e < events && genome.size() > 1; ++e) {
+    uint64_t len = 1 + rnd.below(min(opts.max_segment, (uint64_t)genome.size()-1));
+    uint64_t begin = rnd.below(genome.size()-len+1);
+    string segment = genome.substr(begin, len);
+    if (rnd.below(2)) {
+      reverse(segment.begin(), segment.end());
+      for (auto& c : segment) {
+        c = complement(c);
+      }
+      genome.replace(begin, len, segment);
+    } else {
+      genome.erase(begin, len);
+      genome.insert(rnd.below(genome.size()+1), segment);
+    }
+  }
+}
+
+
+// A random reference followed by genomes-1 independently mutated copies
+inline vector<string> generate_pangenome(const pangenome_options& opts)
+{
+  pangenome_random rnd(opts.seed);
+  vector<string> genomes;
+  string reference;
+  reference.reserve(opts.length);
+  for (uint64_t i = 0; i < opts.length; ++i) {
+    reference.push_back(rnd.base());
+  }
+  genomes.emplace_back(reference);
+  for (uint64_t g = 1; g < opts.genomes; ++g) {
+    string genome = mutate_locally(reference, opts, rnd);
+    uint64_t events = 0;
+    for (uint64_t i = 0; i < reference.size(); ++i) {
+      events += rnd.real() < opts.rearrangement_rate;
+    }
+    rearrange(genome, events, opts, rnd);
+    genomes.emplace_back(genome);
+  }
+  return genomes;
+}
+
+
+// FASTA with 80 columns and headers >g0, >g1, ...
+inline bool write_fasta(const vector<string>& genomes, const string& filename)
+{
+  ofstream out(filename);
+  for (uint64_t g = 0; g < genomes.size(); ++g) {
+    out << ">g" << g << '\n';
+    for (uint64_t i = 0; i < genomes[g].size(); i += 80) {
+      out << genomes[g].substr(i, 80) << '\n';
+    }
+  }
+  return (bool)out;
+}
+
+
+#endif
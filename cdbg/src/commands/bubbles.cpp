@@ -0,0 +1,292 @@
+// std
+#include <algorithm>  // lower_bound, max, min, sort, unique
+#include <fstream>  // ofstream
+#include <iostream>  // cerr, cout, endl, ostream
+#include <string>
+#include <unordered_map>
+#include <utility>  // make_pair, pair
+#include <vector>
+// OpenMP
+#include <omp.h>  // omp_get_thread_num
+// local
+#include "../output_buffer.hpp"  // append_uint, output_buffer
+#include "cdbg/cursor.hpp"  // cursor
+#include "cdbg/io/implicit_stream.hpp"  // load_implicit
+
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::lower_bound;
+using std::make_pair;
+using std::max;
+using std::min;
+using std::ofstream;
+using std::ostream;
+using std::pair;
+using std::sort;
+using std::string;
+using std::unique;
+using std::unordered_map;
+using std::vector;
+using cdbg::io::load_implicit;
+
+
+namespace cdbg {
+namespace commands {
+
+
+// Nodes per block of sinks; the lines of a block are written in node order
+const uint64_t block_size = 1 << 14;
+// Bubbles with more branches are skipped
+const uint64_t max_branches = 64;
+// Nodes expanded per branch before the region is given up as too complex
+const uint64_t max_visits = 1 << 14;
+
+
+// A node reached backwards from the branches of a bubble
+struct reach
+{
+  uint64_t branches = 0;  // bit b: reached from branch b
+  uint64_t depth = 0;  // largest distance from these branches
+};
+
+
+// Scratch space of one thread
+struct bubble_scratch
+{
+  unordered_map<uint64_t, reach> reached;
+  vector<pair<uint64_t, uint64_t>> queue;  // node, distance
+  vector<pair<uint64_t, uint64_t>> uses;  // branch, sequence
+  vector<uint64_t> chain;
+};
+
+
+// The source of the bubble that ends in sink: the node that all branches
+// reach going backwards in at most max_depth nodes, with the smallest
+// largest distance. False if there is none.
+template<class t_cdbg>
+static bool find_source(
+  cursor<t_cdbg>& cur,
+  uint64_t sink,
+  const vector<uint64_t>& branches,
+  uint64_t max_depth,
+  bubble_scratch& scratch,
+  uint64_t& source)
+{
+  scratch.reached.clear();
+  for (uint64_t b = 0; b < branches.size(); ++b) {
+    uint64_t bit = 1ULL << b;
+    uint64_t visits = 0;
+    scratch.queue.assign(1, make_pair(branches[b], 0));
+    for (uint64_t q = 0; q < scratch.queue.size(); ++q) {
+      uint64_t v = scratch.queue[q].first;
+      uint64_t depth = scratch.queue[q].second;
+      reach& r = scratch.reached[v];
+      if (r.branches & bit) {
+        continue;
+      }
+      if (++visits > max_visits) {
+        return false;
+      }
+      r.branches |= bit;
+      r.depth = max(r.depth, depth);
+      if (depth < max_depth) {
+        for (const auto& pred : cur.predecessors(v)) {
+          if (pred != sink) {
+            scratch.queue.emplace_back(pred, depth+1);
+          }
+        }
+      }
+    }
+  }
+  uint64_t all = (branches.size() == 64) ? ~0ULL : (1ULL << branches.size())-1;
+  bool found = false;
+  uint64_t best = 0;
+  for (const auto& r : scratch.reached) {
+    if (r.second.branches == all &&
+        (!found || r.second.depth < best || (r.second.depth == best && r.first < source))) {
+      found = true;
+      best = r.second.depth;
+      source = r.first;
+    }
+  }
+  return found;
+}
+
+
+// If the branch is a simple chain back to source (every node on it has one
+// predecessor), sets allele to the characters between source and sink: what
+// the chain adds to the label of source, less the k-1 characters it shares
+// with sink; empty for an edge from source to sink.
+template<class t_cdbg>
+static bool simple_branch(
+  cursor<t_cdbg>& cur,
+  uint64_t branch,
+  uint64_t source,
+  uint64_t max_depth,
+  bubble_scratch& scratch,
+  string& allele)
+{
+  scratch.chain.clear();
+  for (uint64_t v = branch; v != source;) {
+    const vector<uint64_t>& preds = cur.predecessors(v);
+    if (preds.size() != 1 || scratch.chain.size() == max_depth) {
+      return false;
+    }
+    scratch.chain.emplace_back(v);
+    v = preds[0];
+  }
+  uint64_t overlap = cur.graph().get_k()-1;
+  allele.clear();
+  for (auto it = scratch.chain.rbegin(); it != scratch.chain.rend(); ++it) {
+    string label = cur.node_sequence(*it);
+    if (label.size() > overlap) {
+      allele.append(label, overlap, string::npos);
+    }
+  }
+  allele.resize((allele.size() > overlap) ? allele.size()-overlap : 0);
+  return true;
+}
+
+
+// Appends the line of the bubble that ends in sink, if sink has two or more
+// predecessors and they meet within max_depth nodes
+template<class t_cdbg>
+static void find_bubble(
+  cursor<t_cdbg>& cur,
+  uint64_t sink,
+  uint64_t max_depth,
+  bubble_scratch& scratch,
+  string& line)
+{
+  vector<uint64_t> branches = cur.predecessors(sink);
+  if (branches.size() < 2 || branches.size() > max_branches) {
+    return;
+  }
+  for (const auto& branch : branches) {
+    if (branch == sink) {
+      return;
+    }
+  }
+  uint64_t source = 0;
+  if (!find_source(cur, sink, branches, max_depth, scratch, source)) {
+    return;
+  }
+  // Sequences of every branch, from the uses of its edge into sink
+  scratch.uses.clear();
+  cur.graph().for_each_predecessor_document(sink, [&](uint64_t pred, uint64_t sequence) {
+    scratch.uses.emplace_back(pred, sequence);
+  });
+  sort(scratch.uses.begin(), scratch.uses.end());
+  scratch.uses.erase(unique(scratch.uses.begin(), scratch.uses.end()), scratch.uses.end());
+  bool nested = false;
+  string alleles;
+  string sequences;
+  string allele;
+  for (uint64_t b = 0; b < branches.size(); ++b) {
+    if (b > 0) {
+      alleles.push_back(',');
+      sequences.push_back(';');
+    }
+    if (!simple_branch(cur, branches[b], source, max_depth, scratch, allele)) {
+      nested = true;
+      alleles.push_back('*');
+    } else if (allele.empty()) {
+      alleles.push_back('-');
+    } else {
+      alleles.append(allele);
+    }
+    auto it = lower_bound(scratch.uses.begin(), scratch.uses.end(), make_pair(branches[b], (uint64_t)0));
+    if (it == scratch.uses.end() || it->first != branches[b]) {
+      sequences.push_back('.');
+    }
+    for (bool first = true; it != scratch.uses.end() && it->first == branches[b]; ++it) {
+      if (!first) {
+        sequences.push_back(',');
+      }
+      append_uint(sequences, it->second);
+      first = false;
+    }
+  }
+  append_uint(line, source);
+  line.push_back('\t');
+  append_uint(line, sink);
+  line.push_back('\t');
+  line.push_back(nested ? '1' : '0');
+  line.push_back('\t');
+  line.append(alleles);
+  line.push_back('\t');
+  line.append(sequences);
+  line.push_back('\n');
+}
+
+
+struct bubbles_command
+{
+  const string& filename_output;
+  uint64_t max_depth;
+  uint64_t threads;
+
+  template<class t_cdbg>
+  bool operator()(const t_cdbg& g) const
+  {
+    ofstream file;
+    if (!filename_output.empty()) {
+      file.open(filename_output+".tsv");
+      if (!file.is_open()) {
+        cerr << "Could not open '" << filename_output << ".tsv' for writing." << endl;
+        return false;
+      }
+    }
+    ostream& output = filename_output.empty() ? cout : file;
+    {
+      output_buffer out(output);
+      out.write("#SOURCE\tSINK\tNESTED\tALLELES\tSEQUENCES\n");
+      vector<cursor<t_cdbg>> cursors(threads, cursor<t_cdbg>(g, 1 << 16));
+      vector<bubble_scratch> scratch(threads);
+      vector<string> lines(block_size);
+      uint64_t nodes = g.number_of_nodes();
+      for (uint64_t block = 0; block < nodes; block += block_size) {
+        uint64_t end = min(block+block_size, nodes);
+        #pragma omp parallel for num_threads(threads) schedule(dynamic, 64)
+        for (uint64_t v = block; v < end; ++v) {
+          uint64_t t = omp_get_thread_num();
+          lines[v-block].clear();
+          find_bubble(cursors[t], v, max_depth, scratch[t], lines[v-block]);
+        }
+        for (uint64_t v = block; v < end; ++v) {
+          out.write(lines[v-block]);
+        }
+      }
+    }
+    if (!output) {
+      cerr << "Something went wrong - writing the bubbles didn't work as expected" << endl;
+      return false;
+    }
+    return true;
+  }
+};
+
+
+// Writes every bubble of the graph as a line of filename_output.tsv (stdout
+// if filename_output is empty): its source and sink node, whether a branch
+// has bubbles of its own, the allele of every branch (* if it is not a
+// simple chain) and the sequences that use each branch's edge into the sink.
+// Bubbles are found from their sinks, the nodes with two or more
+// predecessors, by walking the predecessors from the BWT back to the nearest
+// node that all branches reach, so neither the explicit graph nor a
+// successor index is needed. Sinks are processed in parallel, in blocks
+// that are written in node order.
+bool bubbles(
+  const string& filename_graph,
+  const string& filename_output,
+  uint64_t max_depth,
+  uint64_t threads)
+{
+  return load_implicit(filename_graph, bubbles_command{filename_output, max_depth, threads}, load_documents);
+}
+
+
+}  // commands
+}  // cdbg
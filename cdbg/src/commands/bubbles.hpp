@@ -0,0 +1,16 @@
+#ifndef BUBBLES_HPP
+#define BUBBLES_HPP
+
+#include <string>
+
+using std::string;
+
+namespace cdbg {
+namespace commands {
+
+bool bubbles(const string&, const string&, uint64_t, uint64_t);
+
+}
+}
+
+#endif
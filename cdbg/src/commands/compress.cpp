@@ -0,0 +1,89 @@
+// std
+#include <iostream>  // cerr, cout, endl
+#include <string>
+// local
+#include "cdbg/io/compressed_stream.hpp"  // compressed_directory, default_chunk_bytes,
+                                          // read_compressed_directory
+#include "cdbg/io/implicit_stream.hpp"  // load_implicit, store_compressed,
+                                        // store_implicit
+
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+using cdbg::io::compressed_directory;
+using cdbg::io::load_implicit;
+using cdbg::io::read_compressed_directory;
+using cdbg::io::store_compressed;
+using cdbg::io::store_implicit;
+
+
+namespace cdbg {
+namespace commands {
+
+
+struct compress_command
+{
+  const string& filename;
+  int level;
+  uint64_t threads;
+
+  template<class t_cdbg>
+  bool operator()(const t_cdbg& g) const
+  {
+    if (level <= 0) {
+      return store_implicit(g, filename);
+    }
+    return store_compressed(g, filename, level, io::default_chunk_bytes, threads);
+  }
+};
+
+
+// Prints the table of contents of a compressed graph file: the raw and
+// compressed bytes and chunks of every section
+static void print_directory(const compressed_directory& directory)
+{
+  cout << "#SECTION\tRAW_BYTES\tCOMPRESSED_BYTES\tCHUNKS" << endl;
+  uint64_t total = 0;
+  for (const auto& section : directory.sections) {
+    uint64_t bytes = 0;
+    for (uint64_t c = 0; c < section.chunks; ++c) {
+      bytes += directory.chunks[section.first_chunk+c].bytes;
+    }
+    total += bytes;
+    cout << section.name << "\t" << section.raw_bytes << "\t" << bytes << "\t";
+    cout << section.chunks << endl;
+  }
+  cout << "total\t" << directory.header.raw_bytes << "\t" << total << "\t";
+  cout << directory.chunks.size() << endl;
+}
+
+
+// Rewrites the graph as filename_output.bin, a compressed graph file whose
+// components are compressed in chunks at zstd level with threads threads,
+// and prints its table of contents; level 0 writes a plain graph file
+// instead, e.g. to decompress one
+bool compress(
+  const string& filename_graph,
+  const string& filename_output,
+  int level,
+  uint64_t threads)
+{
+  string filename = filename_output+".bin";
+  if (!load_implicit(filename_graph, compress_command{filename, level, threads})) {
+    return false;
+  }
+  if (level > 0) {
+    compressed_directory directory;
+    if (!read_compressed_directory(filename, directory)) {
+      return false;
+    }
+    print_directory(directory);
+  }
+  return true;
+}
+
+
+}  // commands
+}  // cdbg
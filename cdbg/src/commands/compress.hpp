@@ -0,0 +1,16 @@
+#ifndef COMPRESS_HPP
+#define COMPRESS_HPP
+
+#include <string>
+
+using std::string;
+
+namespace cdbg {
+namespace commands {
+
+bool compress(const string&, const string&, int, uint64_t);
+
+}
+}
+
+#endif
@@ -1,79 +1,219 @@
 // std
-#include <algorithm>  // min_element
-#include <fstream>  // ifstream, ofstream
+#include <algorithm>  // min, min_element
+#include <fstream>  // ifstream
 #include <string>
 #include <tuple>  // tie
 #include <vector>  // begin, end
 // sdsl
 #include <sdsl/config.hpp>  // cache_config
+#include <sdsl/int_vector_buffer.hpp>  // int_vector_buffer
+#include <sdsl/io.hpp>  // cache_file_name, store_to_file
 #include <sdsl/util.hpp>  // sdsl::util
 // local
-#include "cdbg/cdbg.hpp"  // CDBG
+#include "cdbg/cdbg.hpp"  // CDBG_BV, CDBG_DNA, CDBG_RRR, CDBG_SD, profile,
+                          // wt_dna
+#include "cdbg/csr_graph.hpp"  // csr_graph
+#include "cdbg/io/implicit_stream.hpp"  // store_compressed, store_implicit
+#include "cdbg/kmer_index.hpp"  // kmer_index
+#include "construct.hpp"  // construct_options
 #include "../create_datastructures.hpp"  // create_bwt, create_da, create_sa,
                                          // create_text
+#include "../handle_graph.hpp"  // verify_graph, verify_text
+#include "../memory_plan.hpp"  // estimate_text_phase, format_memory_size,
+                               // get_text_statistics, memory_plan,
+                               // plan_construction
 
 
 using std::begin;
 using std::end;
 using std::ifstream;
+using std::min;
 using std::min_element;
-using std::ofstream;
 using std::string;
 using std::tie;
 using std::vector;
 using sdsl::cache_config;
+using sdsl::cache_file_name;
+using sdsl::int_vector_buffer;
+using sdsl::store_to_file;
+using cdbg::io::store_compressed;
+using cdbg::io::store_implicit;
 
 
 namespace cdbg {
 namespace commands {
 
 
-void construct(
+// Checks the explicit graph of g against the cached text
+template<class t_cdbg>
+static bool verify(const t_cdbg& g, const cache_config& config, uint64_t threads)
+{
+  csr_graph graph;
+  vector<uint64_t> start_nodes;
+  tie(graph, start_nodes) = g.get_csr_representation(threads);
+  vector<uint64_t> sequences;
+  return verify_graph(graph, start_nodes, g.get_k(), sequences, threads) &&
+         verify_text(g, graph, start_nodes,
+                     cache_file_name(sdsl::conf::KEY_TEXT, config), threads);
+}
+
+
+// The dna profile needs a text of A, C, G, N and T only
+static bool dna_text(const cache_config& config, const string& inputfile)
+{
+  int_vector_buffer<8> text(cache_file_name(sdsl::conf::KEY_TEXT, config));
+  if (wt_dna::contains(text, text.size())) {
+    return true;
+  }
+  cerr << "Input file '" << inputfile << "' contains characters other than ";
+  cerr << "A, C, G, N and T, which the dna profile does not support." << endl;
+  return false;
+}
+
+
+// Creates, stores and optionally verifies the graph for k in the profile of
+// t_cdbg
+template<class t_cdbg>
+static bool construct_graph(
+  cache_config& config,
+  uint64_t k,
+  const string& outputfile,
+  const construct_options& opts)
+{
+  bool sample_documents = opts.with_document_array && opts.document_sample_rate > 0;
+  t_cdbg g(config, k, opts.with_document_array && !sample_documents, opts.sa_sample_rate);
+  if (sample_documents) {
+    g.sample_documents(config, opts.document_sample_rate, opts.color_threshold);
+  }
+  if (opts.bidirectional) {
+    g.build_successor_index();
+  }
+  if (opts.checkpoint_rate > 0) {
+    g.build_node_checkpoints(opts.checkpoint_rate);
+  }
+  string graphfile = outputfile+".k"+to_string(k)+".bin";
+  if (opts.compress_level > 0) {
+    if (!store_compressed(g, graphfile, opts.compress_level, cdbg::io::default_chunk_bytes, opts.threads)) {
+      return false;
+    }
+  } else if (!store_implicit(g, graphfile)) {
+    return false;
+  }
+  if (opts.kmer_fingerprint_bits >= 0) {
+    kmer_index index = g.get_kmer_index(opts.kmer_fingerprint_bits, opts.threads);
+    if (!store_to_file(index, graphfile+".kmers")) {
+      cerr << "Could not write '" << graphfile << ".kmers'." << endl;
+      return false;
+    }
+  }
+  if (opts.verify) {
+    if (verify(g, config, opts.threads)) {
+      cerr << "Graph for k=" << k << " verified." << endl;
+    } else {
+      cerr << "Verification of the graph for k=" << k << " failed." << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+
+bool construct(
   const string& inputfile,
   const string& outputfile,
   const string& kfilename,
-  bool with_document_array)
+  const construct_options& opts)
 {
+  bool ok = true;
   uint64_t min_length = 0;
+  // Read k-values
+  vector<uint64_t> ks;
+  {
+    ifstream kfile(kfilename);
+    uint64_t k;
+    while (kfile >> k) {
+      ks.push_back(k);
+    }
+  }
+  memory_plan plan;
+  plan.budget = opts.memory_budget;
+  plan.graph_profile = opts.graph_profile;
+  if (plan.budget > 0 && estimate_text_phase(inputfile) > plan.budget) {
+    cerr << "Input file '" << inputfile << "' does not fit into the memory budget of ";
+    cerr << format_memory_size(plan.budget) << "." << endl;
+    return false;
+  }
   // Create datastructures
   cache_config config(true, ".", "tmp");
   {
     // Get input
     vector<uint64_t> sequences = create_text(config, inputfile, true);
-    auto min = min_element(begin(sequences), end(sequences));
-    if (min != end(sequences)) {
-      min_length = *min;
+    if (opts.graph_profile == profile::dna && !dna_text(config, inputfile)) {
+      if (config.delete_files) {
+        sdsl::util::delete_all_files(config.file_map);
+      }
+      return false;
+    }
+    auto min_seq = min_element(begin(sequences), end(sequences));
+    if (min_seq != end(sequences)) {
+      min_length = *min_seq;
     }
-    // Get sa
-    bool fast = false; // space-efficient!
-    create_sa(config, fast);
+    // Plan the remaining phases for the smallest k, which has the most nodes
+    if (plan.budget > 0) {
+      uint64_t min_k = min_length;
+      for (const auto& k : ks) {
+        if (k <= min_length) {
+          min_k = min(min_k, k);
+        }
+      }
+      text_statistics stats = get_text_statistics(config, sequences);
+      bool fits = plan_construction(stats, min_k, opts.with_document_array,
+                                    opts.document_sample_rate,
+                                    opts.choose_profile, plan);
+      if (!fits) {
+        if (config.delete_files) {
+          sdsl::util::delete_all_files(config.file_map);
+        }
+        return false;
+      }
+    }
+    // Get sa, space-efficient unless the budget allows otherwise
+    create_sa(config, plan.fast_sa);
     // Get bwt
     create_bwt(config);
     // Get document array
-    if (with_document_array) {
+    if (opts.with_document_array) {
       create_da(config, sequences);
     }
   }
-  // Read k-values
-  ifstream kfile(kfilename);
-  uint64_t k;
-  while (kfile >> k) {
+  for (const auto& k : ks) {
     if (min_length < k) {
       cerr << "k=" << k << " must smaller than sequence length";
       cerr << ", but in input file '" << inputfile << "' there is a sequence with length ";
       cerr << min_length << " - this k-values will be skipped." << endl;
     } else {
-      // Create graph
-      CDBG g(config, k, with_document_array);
-      // Store graph
-      ofstream out(outputfile+".k"+to_string(k)+".bin");
-      g.serialize(out);
+      // Create, store and verify graph
+      switch (plan.graph_profile) {
+        case profile::sd:
+          ok &= construct_graph<CDBG_SD>(config, k, outputfile, opts);
+          break;
+        case profile::rrr:
+          ok &= construct_graph<CDBG_RRR>(config, k, outputfile, opts);
+          break;
+        case profile::dna:
+          ok &= construct_graph<CDBG_DNA>(config, k, outputfile, opts);
+          break;
+        default:
+          ok &= construct_graph<CDBG_BV>(config, k, outputfile, opts);
+          break;
+      }
     }
   }
   // Delete files
   if (config.delete_files) {
     sdsl::util::delete_all_files(config.file_map);
   }
+  return ok;
 }
 
 
@@ -3,12 +3,30 @@
 
 #include <string>
 
+#include "cdbg/cdbg.hpp"  // profile
+
 using std::string;
 
 namespace cdbg {
 namespace commands {
 
-void construct(const string&, const string&, const string&, bool);
+struct construct_options {
+  bool with_document_array = true;
+  bool verify = false;  // check every graph against the input text
+  uint64_t threads = 1;
+  uint64_t sa_sample_rate = 0;  // 0: no suffix array samples, no locate
+  profile graph_profile = profile::bv;
+  bool bidirectional = false;  // successor index for forward navigation
+  uint64_t checkpoint_rate = 0;  // 0: no node checkpoints for find_nodes
+  uint64_t document_sample_rate = 0;  // 0: document array, else samples
+  uint64_t color_threshold = 0;  // with samples, color lists of nodes this frequent
+  uint64_t memory_budget = 0;  // bytes, 0: unlimited
+  bool choose_profile = false;  // pick the profile that fits memory_budget
+  int compress_level = 0;  // zstd level of a compressed graph file, 0: plain
+  int kmer_fingerprint_bits = -1;  // of a kmer index next to the graph, -1: none
+};
+
+bool construct(const string&, const string&, const string&, const construct_options&);
 
 }
 }
@@ -0,0 +1,122 @@
+// std
+#include <chrono>  // duration_cast, high_resolution_clock, milliseconds
+#include <fstream>  // ifstream
+#include <iomanip>  // setw
+#include <iostream>  // cerr, cout, endl
+#include <string>
+#include <utility>  // pair
+#include <vector>
+// sdsl
+#include <sdsl/io.hpp>  // load_from_file, store_to_file
+// local
+#include "cdbg/coordinate_index.hpp"  // coordinate_index
+#include "cdbg/io/implicit_stream.hpp"  // load_implicit
+
+using std::chrono::duration_cast;
+using std::chrono::high_resolution_clock;
+using std::chrono::milliseconds;
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::ifstream;
+using std::pair;
+using std::setw;
+using std::string;
+using std::vector;
+using sdsl::load_from_file;
+using sdsl::store_to_file;
+using cdbg::io::load_implicit;
+
+
+namespace cdbg {
+namespace commands {
+
+
+struct index_coordinates_command
+{
+  const string& filename_graph;
+  uint64_t rate;
+  uint64_t threads;
+
+  template<class t_cdbg>
+  bool operator()(const t_cdbg& g) const
+  {
+    coordinate_index index = g.get_coordinate_index(rate, threads);
+    if (!store_to_file(index, filename_graph+".coords")) {
+      cerr << "Could not write '" << filename_graph << ".coords'." << endl;
+      return false;
+    }
+    cerr << index.checkpoints() << " checkpoints for " << index.sequences();
+    cerr << " sequences written to '" << filename_graph << ".coords'." << endl;
+    return true;
+  }
+};
+
+
+// Writes the coordinate index of the graph to filename_graph.coords
+bool index_coordinates(const string& filename_graph, uint64_t rate, uint64_t threads)
+{
+  return load_implicit(filename_graph, index_coordinates_command{filename_graph, rate, threads}, 0);
+}
+
+
+struct find_region_command
+{
+  const string& filename_graph;
+  const string& filename_region;
+
+  template<class t_cdbg>
+  bool operator()(const t_cdbg& g) const
+  {
+    coordinate_index index;
+    if (!load_from_file(index, filename_graph+".coords")) {
+      cerr << "Could not read '" << filename_graph << ".coords'; ";
+      cerr << "create it with the index_coordinates command." << endl;
+      return false;
+    }
+    if (index.graph_id() != g.graph_id()) {
+      cerr << "'" << filename_graph << ".coords' was built for another graph; ";
+      cerr << "recreate it with the index_coordinates command." << endl;
+      return false;
+    }
+    ifstream regionfile(filename_region);
+    uint64_t seq;
+    uint64_t begin;
+    uint64_t end;
+    uint64_t number_regions = 0;
+    auto t1 = high_resolution_clock::now();
+    auto t2 = high_resolution_clock::now();
+    auto time_region = t2-t2;
+    while (regionfile >> seq >> begin >> end) {
+      ++number_regions;
+      if (seq >= index.sequences()) {
+        cerr << "Sequence " << seq << " does not exist; the graph has ";
+        cerr << index.sequences() << " sequences." << endl;
+        continue;
+      }
+      t1 = high_resolution_clock::now();
+      vector<pair<uint64_t, uint64_t>> nodes = g.region_nodes(index, seq, begin, end);
+      t2 = high_resolution_clock::now();
+      time_region += t2-t1;
+      cout << "Region " << seq << ":" << begin << "-" << end << " is covered by " << nodes.size() << " nodes";
+      for (uint64_t i = 0; i < nodes.size(); ++i) {
+        cout << (i ? ", " : ": ") << nodes[i].first << "@" << nodes[i].second;
+      }
+      cout << endl;
+    }
+    cout << setw(10) << duration_cast<milliseconds>(time_region).count() << "ms to find " << number_regions << " regions." << endl;
+    return true;
+  }
+};
+
+
+// Prints the nodes covering every region of filename_region; each line of it
+// is "sequence begin end" with 0-indexed offsets and end exclusive
+bool find_region(const string& filename_graph, const string& filename_region)
+{
+  return load_implicit(filename_graph, find_region_command{filename_graph, filename_region}, 0);
+}
+
+
+}  // commands
+}  // cdbg
@@ -0,0 +1,17 @@
+#ifndef COORDINATES_HPP
+#define COORDINATES_HPP
+
+#include <string>
+
+using std::string;
+
+namespace cdbg {
+namespace commands {
+
+bool index_coordinates(const string&, uint64_t, uint64_t);
+bool find_region(const string&, const string&);
+
+}
+}
+
+#endif
@@ -0,0 +1,123 @@
+// std
+#include <algorithm>  // min
+#include <fstream>  // ofstream
+#include <iostream>  // cerr, endl
+#include <sstream>  // istringstream
+#include <string>  // getline, stoull, string
+#include <vector>
+// local
+#include "../output_buffer.hpp"  // output_buffer
+#include "cdbg/io/implicit_stream.hpp"  // load_implicit
+
+
+using std::cerr;
+using std::endl;
+using std::getline;
+using std::istringstream;
+using std::min;
+using std::ofstream;
+using std::stoull;
+using std::string;
+using std::vector;
+using cdbg::io::load_implicit;
+
+
+namespace cdbg {
+namespace commands {
+
+
+// Characters per FASTA line
+const uint64_t line_width = 80;
+
+
+// Parses a comma separated list of sequence ids; an empty list selects all d
+// sequences
+static bool parse_sequence_ids(const string& list, uint64_t d, vector<uint64_t>& ids)
+{
+  ids.clear();
+  if (list.empty()) {
+    for (uint64_t id = 0; id < d; ++id) {
+      ids.emplace_back(id);
+    }
+    return true;
+  }
+  istringstream in(list);
+  string item;
+  while (getline(in, item, ',')) {
+    uint64_t id = d;
+    try {
+      id = stoull(item);
+    } catch (...) { }
+    if (id >= d) {
+      cerr << "'" << item << "' is not a sequence id; the graph has ";
+      cerr << d << " sequences." << endl;
+      return false;
+    }
+    ids.emplace_back(id);
+  }
+  return true;
+}
+
+
+struct extract_command
+{
+  const string& filename_output;
+  const string& sequence_list;
+  uint64_t threads;
+
+  template<class t_cdbg>
+  bool operator()(const t_cdbg& g) const
+  {
+    vector<uint64_t> sentinels = g.sequence_sentinels(threads);
+    vector<uint64_t> ids;
+    if (!parse_sequence_ids(sequence_list, sentinels.size(), ids)) {
+      return false;
+    }
+    ofstream output(filename_output+".fa");
+    if (!output.is_open()) {
+      cerr << "Could not open '" << filename_output << ".fa' for writing." << endl;
+      return false;
+    }
+    output_buffer out(output);
+    // Sequences are spelled in parallel and written in order; a thread
+    // holds its sequence only until the ordered writer reaches it
+    #pragma omp parallel for ordered num_threads(threads) schedule(dynamic, 1)
+    for (uint64_t j = 0; j < ids.size(); ++j) {
+      string sequence = g.extract_sequence(sentinels[ids[j]]);
+      #pragma omp ordered
+      {
+        out.write('>');
+        out.write_uint(ids[j]);
+        out.write('\n');
+        for (uint64_t i = 0; i < sequence.size(); i += line_width) {
+          out.write(sequence.data()+i, min(line_width, sequence.size()-i));
+          out.write('\n');
+        }
+      }
+    }
+    out.flush();
+    if (!output) {
+      cerr << "Something went wrong - writing '" << filename_output << ".fa' didn't work as expected" << endl;
+      return false;
+    }
+    return true;
+  }
+};
+
+
+// Rebuilds the selected sequences (all if sequence_list is empty) from the
+// BWT of the graph and writes them to filename_output.fa, headed by their
+// sequence ids. Each sequence is spelled independently from its sentinel, so
+// the sequences are extracted in parallel and written in order.
+bool extract(
+  const string& filename_graph,
+  const string& filename_output,
+  const string& sequence_list,
+  uint64_t threads)
+{
+  return load_implicit(filename_graph, extract_command{filename_output, sequence_list, threads}, load_documents);
+}
+
+
+}  // commands
+}  // cdbg
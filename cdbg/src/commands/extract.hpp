@@ -0,0 +1,16 @@
+#ifndef EXTRACT_HPP
+#define EXTRACT_HPP
+
+#include <string>
+
+using std::string;
+
+namespace cdbg {
+namespace commands {
+
+bool extract(const string&, const string&, const string&, uint64_t);
+
+}
+}
+
+#endif
@@ -1,15 +1,22 @@
 // std
 #include <chrono>  // duration_cast, high_resolution_clock, milliseconds
-#include <iostream>  // cout, endl
+#include <fstream>  // ifstream
+#include <iostream>  // cerr, cout, endl
+// sdsl
+#include <sdsl/io.hpp>  // load_from_file, store_to_file
 // local
-#include "cdbg/cdbg.hpp"  // CDBG
 #include "cdbg/io/implicit_stream.hpp"  // load_implicit
+#include "cdbg/kmer_index.hpp"  // kmer_index, min_kmer_fingerprint_bits
 
 using std::chrono::duration_cast;
 using std::chrono::high_resolution_clock;
 using std::chrono::milliseconds;
+using std::cerr;
 using std::cout;
 using std::endl;
+using std::ifstream;
+using sdsl::load_from_file;
+using sdsl::store_to_file;
 using cdbg::io::load_implicit;
 
 
@@ -17,61 +24,151 @@ namespace cdbg {
 namespace commands {
 
 
-void find_pattern(const string& filename_graph, const string& filename_pattern)
+struct index_kmers_command
 {
-  // Load Graph and input
-  CDBG g = load_implicit(filename_graph);
-  ifstream patternfile(filename_pattern);
-  string p;
-  vector<string> pattern;
-  auto t1 = high_resolution_clock::now();
-  auto t2 = high_resolution_clock::now();
-  auto time_search_pattern = t2-t2;
-  auto time_documents_of_first_node = t2-t2;
-  auto time_documents_of_all_nodes = t2-t2;
-  uint64_t number_patterns = 0;
-  uint64_t number_found = 0;
-  while (patternfile >> p) {
-    ++number_patterns;
-    vector<uint64_t> node_sequences;
-    uint64_t tmp;
-    t1 = high_resolution_clock::now();
-    tie(node_sequences, tmp) = g.find_nodes(p);
-    t2 = high_resolution_clock::now();
-    time_search_pattern += t2-t1;
-    if (node_sequences.size()) {
-      cout << "Pattern '" << p << "' occurs in the following nodes: ";
-      cout << node_sequences[0];
-      for (uint64_t i = 1; i < node_sequences.size(); ++i) {
-        cout << ", " << node_sequences[i];
-      }
-      cout << endl;
-      ++number_found;
+  const string& filename_graph;
+  uint64_t fingerprint_bits;
+  uint64_t threads;
+
+  template<class t_cdbg>
+  bool operator()(const t_cdbg& g) const
+  {
+    kmer_index index = g.get_kmer_index(fingerprint_bits, threads);
+    if (!store_to_file(index, filename_graph+".kmers")) {
+      cerr << "Could not write '" << filename_graph << ".kmers'." << endl;
+      return false;
+    }
+    cerr << index.kmers() << " kmers with " << index.fingerprint_bits();
+    cerr << " bit fingerprints written to '" << filename_graph << ".kmers'." << endl;
+    return true;
+  }
+};
+
+
+// Writes the kmer index of the graph to filename_graph.kmers
+bool index_kmers(const string& filename_graph, uint64_t fingerprint_bits, uint64_t threads)
+{
+  return load_implicit(filename_graph, index_kmers_command{filename_graph, fingerprint_bits, threads}, 0);
+}
+
+
+// Loads filename_graph.kmers into index if it exists and belongs to g
+template<class t_cdbg>
+static bool load_kmer_index(const t_cdbg& g, const string& filename_graph, kmer_index& index)
+{
+  string filename_index = filename_graph+".kmers";
+  if (!ifstream(filename_index).good()) {
+    return false;
+  }
+  if (!load_from_file(index, filename_index)) {
+    cerr << "Could not read '" << filename_index << "'." << endl;
+    return false;
+  }
+  if (index.graph_id() != g.graph_id()) {
+    cerr << "Ignoring '" << filename_index << "', which was built for another graph." << endl;
+    return false;
+  }
+  if (index.fingerprint_bits() < min_kmer_fingerprint_bits) {
+    cerr << "Ignoring '" << filename_index << "', whose fingerprints of ";
+    cerr << index.fingerprint_bits() << " bits would report too many absent kmers." << endl;
+    return false;
+  }
+  return true;
+}
+
+
+struct find_pattern_command
+{
+  const string& filename_graph;
+  const string& filename_pattern;
+  bool list_documents;
+
+  template<class t_cdbg>
+  bool operator()(const t_cdbg& g) const
+  {
+    kmer_index index;
+    bool indexed = load_kmer_index(g, filename_graph, index);
+    ifstream patternfile(filename_pattern);
+    string p;
+    vector<string> pattern;
+    auto t1 = high_resolution_clock::now();
+    auto t2 = high_resolution_clock::now();
+    auto time_search_pattern = t2-t2;
+    auto time_documents_of_first_node = t2-t2;
+    auto time_documents_of_all_nodes = t2-t2;
+    uint64_t number_patterns = 0;
+    uint64_t number_found = 0;
+    while (patternfile >> p) {
+      ++number_patterns;
+      vector<uint64_t> node_sequences;
+      uint64_t tmp;
       t1 = high_resolution_clock::now();
-      vector<uint64_t> seq = g.sequences_in_node(node_sequences.front());
+      if (indexed && p.size() == g.get_k()) {
+        uint64_t node;
+        if (index.find(p.data(), node, tmp)) {
+          node_sequences.push_back(node);
+        }
+      } else {
+        tie(node_sequences, tmp) = g.find_nodes(p);
+      }
       t2 = high_resolution_clock::now();
-      time_documents_of_first_node += t2-t1;
-      t1 = high_resolution_clock::now();
-      for (const auto& nodeid : node_sequences) {
-        vector<uint64_t> seq = g.sequences_in_node(nodeid);
-        cout << "Node " << nodeid << " corresponds to a substring that occurs in the following sequences: ";
-        cout << seq[0];
-        for (uint64_t i = 1; i < seq.size(); ++i) {
-          cout << ", " << seq[i];
+      time_search_pattern += t2-t1;
+      if (node_sequences.size()) {
+        cout << "Pattern '" << p << "' occurs in the following nodes: ";
+        cout << node_sequences[0];
+        for (uint64_t i = 1; i < node_sequences.size(); ++i) {
+          cout << ", " << node_sequences[i];
         }
         cout << endl;
+        ++number_found;
+        if (!list_documents) {
+          cout << endl;
+          continue;
+        }
+        t1 = high_resolution_clock::now();
+        vector<uint64_t> seq = g.sequences_in_node(node_sequences.front());
+        t2 = high_resolution_clock::now();
+        time_documents_of_first_node += t2-t1;
+        t1 = high_resolution_clock::now();
+        for (const auto& nodeid : node_sequences) {
+          if (!g.has_documents()) {
+            cout << "Node " << nodeid << ": the graph has no document array." << endl;
+            continue;
+          }
+          vector<uint64_t> seq = g.sequences_in_node(nodeid);
+          cout << "Node " << nodeid << " corresponds to a substring that occurs in the following sequences: ";
+          cout << seq[0];
+          for (uint64_t i = 1; i < seq.size(); ++i) {
+            cout << ", " << seq[i];
+          }
+          cout << endl;
+        }
+        t2 = high_resolution_clock::now();
+        time_documents_of_all_nodes += t2-t1;
+      } else {
+        cout << "Pattern '" << p << "' does not occur." << endl;
       }
-      t2 = high_resolution_clock::now();
-      time_documents_of_all_nodes += t2-t1;
-    } else {
-      cout << "Pattern '" << p << "' does not occur." << endl;
+      cout << endl;
     }
-    cout << endl;
+    cout << "Found " << number_found << " of " << number_patterns << " Pattern" << endl;
+    cout << setw(10) << duration_cast<milliseconds>(time_search_pattern).count() << "ms to search pattern." << endl;
+    cout << setw(10) << duration_cast<milliseconds>(time_documents_of_first_node).count() << "ms to list documents of the first node." << endl;
+    cout << setw(10) << duration_cast<milliseconds>(time_documents_of_all_nodes).count() << "ms to list documents of all nodes." << endl;
+    return true;
   }
-  cout << "Found " << number_found << " of " << number_patterns << " Pattern" << endl;
-  cout << setw(10) << duration_cast<milliseconds>(time_search_pattern).count() << "ms to search pattern." << endl;
-  cout << setw(10) << duration_cast<milliseconds>(time_documents_of_first_node).count() << "ms to list documents of the first node." << endl;
-  cout << setw(10) << duration_cast<milliseconds>(time_documents_of_all_nodes).count() << "ms to list documents of all nodes." << endl;
+};
+
+
+// Prints the nodes of every pattern and, with list_documents, the sequences
+// of each node; without, the documents are not even loaded. Patterns of
+// length k are looked up in filename_graph.kmers if it exists. False if the
+// graph or its documents could not be loaded.
+bool find_pattern(const string& filename_graph, const string& filename_pattern, bool list_documents)
+{
+  return load_implicit(
+    filename_graph,
+    find_pattern_command{filename_graph, filename_pattern, list_documents},
+    list_documents ? load_documents : 0);
 }
 
 
@@ -4,7 +4,8 @@
 namespace cdbg {
 namespace commands {
 
-void find_pattern(const string&, const string&);
+bool index_kmers(const string&, uint64_t, uint64_t);
+bool find_pattern(const string&, const string&, bool);
 
 }
 }
@@ -6,7 +6,8 @@
 #include <vector>
 // local
 #include "../handle_graph.hpp"  // print_graph
-#include "cdbg/cdbg.hpp"  // CDBG
+#include "../stream_graph.hpp"  // stream_graph
+#include "cdbg/csr_graph.hpp"  // csr_graph
 #include "cdbg/io/implicit_stream.hpp"  // load_implicit
 
 
@@ -16,7 +17,7 @@ using std::ofstream;
 using std::string;
 using std::tie;
 using std::vector;
-using cdbg::CDBG;
+using cdbg::csr_graph;
 using cdbg::io::load_implicit;
 
 
@@ -24,22 +25,45 @@ namespace cdbg {
 namespace commands {
 
 
-bool impl2expl(const string& filename_graph, const string& filename_output)
+struct impl2expl_command
 {
-  CDBG g = load_implicit(filename_graph);
-  vector<node> graph;
-  vector<uint64_t> start_nodes;
-  tie(graph, start_nodes) = g.get_explicit_representation();
-  ofstream output(filename_output+".dot");
-  ofstream output_start_nodes(filename_output+".start_nodes.txt");
-  if (!output.is_open() || !output_start_nodes.is_open()) {
-    cerr << "Could not open '" << filename_output << ".dot' or '";
-    cerr << filename_output << ".start_nodes.txt' for writing." << endl;
-    return false;
-  } else {
-    print_graph(graph, start_nodes, output, output_start_nodes);
+  const string& filename_output;
+  uint64_t threads;
+  bool stream;
+  uint64_t buffer_size;
+
+  template<class t_cdbg>
+  bool operator()(const t_cdbg& g) const
+  {
+    if (stream) {
+      return stream_graph(g, filename_output, buffer_size);
+    }
+    csr_graph graph;
+    vector<uint64_t> start_nodes;
+    tie(graph, start_nodes) = g.get_csr_representation(threads);
+    ofstream output(filename_output+".dot");
+    ofstream output_start_nodes(filename_output+".start_nodes.txt");
+    if (!output.is_open() || !output_start_nodes.is_open()) {
+      cerr << "Could not open '" << filename_output << ".dot' or '";
+      cerr << filename_output << ".start_nodes.txt' for writing." << endl;
+      return false;
+    } else {
+      print_graph(graph, start_nodes, output, output_start_nodes);
+    }
+    return true;
   }
-  return true;
+};
+
+
+bool impl2expl(
+  const string& filename_graph,
+  const string& filename_output,
+  uint64_t threads,
+  bool stream,
+  uint64_t buffer_size)
+{
+  return load_implicit(filename_graph,
+    impl2expl_command{filename_output, threads, stream, buffer_size}, 0);
 }
 
 
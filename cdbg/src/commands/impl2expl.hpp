@@ -8,7 +8,7 @@ using std::string;
 namespace cdbg {
 namespace commands {
 
-bool impl2expl(const string&, const string&);
+bool impl2expl(const string&, const string&, uint64_t, bool, uint64_t);
 
 }
 }
@@ -0,0 +1,138 @@
+// std
+#include <algorithm>  // min
+#include <fstream>  // ofstream
+#include <iostream>  // cerr, endl
+#include <limits>  // numeric_limits
+#include <string>
+#include <vector>
+// local
+#include "../output_buffer.hpp"  // append_uint, output_buffer
+#include "cdbg/io/implicit_stream.hpp"  // load_implicit
+
+
+using std::cerr;
+using std::endl;
+using std::min;
+using std::numeric_limits;
+using std::ofstream;
+using std::string;
+using std::vector;
+using cdbg::io::load_implicit;
+
+
+namespace cdbg {
+namespace commands {
+
+
+// Nodes whose segment and link lines are built in parallel before writing
+const uint64_t block_size = 1<<14;
+
+
+struct impl2gfa_command
+{
+  const string& filename_output;
+  uint64_t threads;
+
+  template<class t_cdbg>
+  bool operator()(const t_cdbg& g) const
+  {
+    ofstream output(filename_output+".gfa");
+    if (!output.is_open()) {
+      cerr << "Could not open '" << filename_output << ".gfa' for writing." << endl;
+      return false;
+    }
+    output_buffer out(output);
+    out.write("H\tVN:Z:1.0\n");
+    uint64_t nodes = g.number_of_nodes();
+    vector<bool> stop_node(nodes, false);
+    for (const auto& nodeid : g.get_stop_nodes()) {
+      stop_node[nodeid] = true;
+    }
+    uint64_t k = g.get_k();
+    // Segments and links
+    vector<string> lines(block_size);
+    for (uint64_t block = 0; block < nodes; block += block_size) {
+      uint64_t end = min(block+block_size, nodes);
+      #pragma omp parallel for num_threads(threads) schedule(dynamic, 64)
+      for (uint64_t v = block; v < end; ++v) {
+        string& line = lines[v-block];
+        line.clear();
+        if (stop_node[v]) {
+          continue;
+        }
+        string label = g.node_sequence(v);
+        line += "S\t";
+        append_uint(line, v);
+        line += '\t';
+        line += label;
+        line += '\n';
+        // Labels end before a sentinel, so the k-1 overlap is clamped to
+        // the lengths of both segments it joins
+        uint64_t overlap = min(k-1, (uint64_t)label.size());
+        g.for_each_predecessor(v, [&](uint64_t u) {
+          line += "L\t";
+          append_uint(line, u);
+          line += "\t+\t";
+          append_uint(line, v);
+          line += "\t+\t";
+          append_uint(line, g.node_sequence(u, overlap).size());
+          line += "M\n";
+        });
+      }
+      for (uint64_t v = block; v < end; ++v) {
+        out.write(lines[v-block]);
+      }
+    }
+    // Paths; every sequence's walk starts with its stop node
+    uint64_t sequence = g.get_stop_nodes().size();
+    vector<uint64_t> path;
+    auto write_path = [&]() {
+      out.write("P\t");
+      out.write_uint(sequence);
+      out.write('\t');
+      for (uint64_t j = path.size()-1; j < path.size(); --j) {
+        out.write_uint(path[j]);
+        out.write(j ? "+," : "+");
+      }
+      out.write("\t*\n");
+    };
+    g.for_each_occurrence([&](uint64_t node, uint64_t, uint64_t next) {
+      if (next == numeric_limits<uint64_t>::max()) {
+        if (!path.empty()) {
+          write_path();
+          path.clear();
+        }
+        --sequence;
+      } else {
+        path.emplace_back(node);
+      }
+    });
+    if (!path.empty()) {
+      write_path();
+    }
+    out.flush();
+    if (!output) {
+      cerr << "Something went wrong - writing '" << filename_output << ".gfa' didn't work as expected" << endl;
+      return false;
+    }
+    return true;
+  }
+};
+
+
+// Writes one segment per node (stop nodes excluded) with the node label
+// spelled from the BWT, one link per edge with an overlap of k-1 and one path
+// per sequence. Segments and links are built in parallel per block of nodes;
+// paths are written while the sequences are walked, last sequence first. So
+// neither the input FASTA nor the explicit graph is needed.
+bool impl2gfa(
+  const string& filename_graph,
+  const string& filename_output,
+  uint64_t threads)
+{
+  return load_implicit(filename_graph, impl2gfa_command{filename_output, threads}, 0);
+}
+
+
+}  // commands
+}  // cdbg
@@ -0,0 +1,16 @@
+#ifndef IMPL2GFA_HPP
+#define IMPL2GFA_HPP
+
+#include <string>
+
+using std::string;
+
+namespace cdbg {
+namespace commands {
+
+bool impl2gfa(const string&, const string&, uint64_t);
+
+}
+}
+
+#endif
@@ -0,0 +1,81 @@
+// std
+#include <algorithm>  // sort
+#include <chrono>  // duration_cast, high_resolution_clock, milliseconds
+#include <fstream>  // ifstream
+#include <iomanip>  // setw
+#include <iostream>  // cerr, cout, endl
+#include <string>
+#include <utility>  // pair
+#include <vector>
+// local
+#include "cdbg/io/implicit_stream.hpp"  // load_implicit
+
+using std::chrono::duration_cast;
+using std::chrono::high_resolution_clock;
+using std::chrono::milliseconds;
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::ifstream;
+using std::pair;
+using std::setw;
+using std::sort;
+using std::string;
+using std::vector;
+using cdbg::io::load_implicit;
+
+
+namespace cdbg {
+namespace commands {
+
+
+struct locate_command
+{
+  const string& filename_graph;
+  const string& filename_pattern;
+
+  template<class t_cdbg>
+  bool operator()(const t_cdbg& g) const
+  {
+    if (g.sa_sample_rate() == 0) {
+      cerr << "Graph '" << filename_graph << "' has no sampled suffix array; ";
+      cerr << "construct it with --samplerate." << endl;
+      return false;
+    }
+    ifstream patternfile(filename_pattern);
+    string p;
+    auto t1 = high_resolution_clock::now();
+    auto t2 = high_resolution_clock::now();
+    auto time_locate = t2-t2;
+    uint64_t number_patterns = 0;
+    uint64_t number_occurrences = 0;
+    while (patternfile >> p) {
+      ++number_patterns;
+      t1 = high_resolution_clock::now();
+      vector<pair<uint64_t, uint64_t>> occurrences = g.locate(p);
+      t2 = high_resolution_clock::now();
+      time_locate += t2-t1;
+      number_occurrences += occurrences.size();
+      sort(occurrences.begin(), occurrences.end());
+      cout << "Pattern '" << p << "' occurs " << occurrences.size() << " times";
+      for (uint64_t i = 0; i < occurrences.size(); ++i) {
+        cout << (i ? ", " : ": ") << occurrences[i].first << ":" << occurrences[i].second;
+      }
+      cout << endl;
+    }
+    cout << "Found " << number_occurrences << " occurrences of " << number_patterns << " Pattern" << endl;
+    cout << setw(10) << duration_cast<milliseconds>(time_locate).count() << "ms to locate pattern." << endl;
+    return true;
+  }
+};
+
+
+// Prints every occurrence of every pattern as sequence:offset (0-indexed)
+bool locate(const string& filename_graph, const string& filename_pattern)
+{
+  return load_implicit(filename_graph, locate_command{filename_graph, filename_pattern}, load_locate);
+}
+
+
+}  // commands
+}  // cdbg
@@ -0,0 +1,16 @@
+#ifndef LOCATE_HPP
+#define LOCATE_HPP
+
+#include <string>
+
+using std::string;
+
+namespace cdbg {
+namespace commands {
+
+bool locate(const string&, const string&);
+
+}
+}
+
+#endif
@@ -2,8 +2,8 @@
 #include <iostream>  // cerr
 #include <string>
 // local
-#include "cdbg/cdbg.hpp"  // CDBG
-#include "cdbg/io/implicit_stream.hpp"  //load_implicit
+#include "cdbg/cdbg.hpp"  // profile_name, profile_of
+#include "cdbg/io/implicit_stream.hpp"  // load_implicit
 
 
 using std::cerr;
@@ -15,11 +15,22 @@ namespace cdbg {
 namespace commands {
 
 
-void print_graph_details(const string& graphfile)
+struct print_graph_details_command
+{
+  template<class t_cdbg>
+  bool operator()(const t_cdbg& g) const
+  {
+    cerr << "Profile: " << profile_name(profile_of(g)) << endl;
+    g.print_graph_statistics(cerr);
+    return true;
+  }
+};
+
+
+bool print_graph_details(const string& graphfile)
 {
   cerr << endl << graphfile << ":" << endl;
-  CDBG g = load_implicit(graphfile);
-  g.print_graph_statistics(cerr);
+  return load_implicit(graphfile, print_graph_details_command(), load_documents);
 }
 
 
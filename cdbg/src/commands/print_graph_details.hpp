@@ -4,7 +4,7 @@
 namespace cdbg {
 namespace commands {
 
-void print_graph_details(const string&);
+bool print_graph_details(const string&);
 
 }
 }
@@ -0,0 +1,69 @@
+// std
+#include <fstream>  // ofstream
+#include <iostream>  // cerr, cout, endl
+#include <string>
+// local
+#include "cdbg/cdbg.hpp"  // profile_name, profile_of
+#include "cdbg/io/implicit_stream.hpp"  // load_implicit
+#include "cdbg/space.hpp"  // resident_memory, space_breakdown, space_report,
+                           // write_space_html, write_space_json
+
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::ofstream;
+using std::string;
+using cdbg::io::load_implicit;
+
+
+namespace cdbg {
+namespace commands {
+
+
+struct space_command
+{
+  space_report& report;
+
+  template<class t_cdbg>
+  bool operator()(const t_cdbg& g) const
+  {
+    report.resident_after = resident_memory();
+    report.profile = profile_name(profile_of(g));
+    report.text_length = g.text_length();
+    report.root = space_breakdown(g);
+    return true;
+  }
+};
+
+
+// Prints the size of every component of the graph and the resident memory
+// after loading it as JSON; with an output file, writes filename_output.json
+// and filename_output.html instead
+bool space(const string& filename_graph, const string& filename_output)
+{
+  space_report report;
+  report.graph = filename_graph;
+  report.resident_before = resident_memory();
+  if (!load_implicit(filename_graph, space_command{report})) {
+    return false;
+  }
+  if (filename_output.empty()) {
+    write_space_json(report, cout);
+    return true;
+  }
+  ofstream json(filename_output+".json");
+  ofstream html(filename_output+".html");
+  if (!json.is_open() || !html.is_open()) {
+    cerr << "Could not open '" << filename_output << ".json' or '";
+    cerr << filename_output << ".html' for writing." << endl;
+    return false;
+  }
+  write_space_json(report, json);
+  write_space_html(report, html);
+  return json && html;
+}
+
+
+}  // commands
+}  // cdbg
@@ -0,0 +1,16 @@
+#ifndef SPACE_COMMAND_HPP
+#define SPACE_COMMAND_HPP
+
+#include <string>
+
+using std::string;
+
+namespace cdbg {
+namespace commands {
+
+bool space(const string&, const string&);
+
+}
+}
+
+#endif
@@ -2,23 +2,30 @@
 #define HANDLE_GRAPH
 
 // std
+#include <algorithm>  // sort
 #include <iostream>  // cerr, cout, endl, ostream
+#include <string>
 #include <vector>
+// sdsl
+#include <sdsl/int_vector_buffer.hpp>  // int_vector_buffer
 
 
 using std::cerr;
 using std::cout;
 using std::endl;
 using std::ostream;
+using std::sort;
+using std::string;
 using std::vector;
+using sdsl::int_vector_buffer;
 
 
 namespace cdbg {
 
 
-template<class t_node>
+template<class t_graph>
 void print_graph(
-  const vector<t_node>& graph,
+  const t_graph& graph,
   const vector<uint64_t>& start_nodes,
   ostream& out=cout,
   ostream& out2=cout)
@@ -56,127 +63,210 @@ void print_graph(
 }
 
 
-template<class t_node>
-bool verify_graph(vector<t_node> graph, uint64_t k, vector<uint64_t>& sequenzes) // call-by-value
+// Index of position pos in a (descending) position list, or list.size()
+template<class t_list>
+uint64_t find_position(const t_list& list, uint64_t pos)
 {
-  uint64_t start_pos = 1;
-  bool done = false;
-  while (!done) {
-    // Search node start with position start_pos
-    uint64_t start_node=graph.size();
-    for (uint64_t i = 0; i < graph.size(); ++i) {
-      if (graph[i].pos_list.size() > 0 && graph[i].pos_list.back() == start_pos) {
-        start_node = i;
-        break;
-      }
+  uint64_t lo = 0;
+  uint64_t hi = list.size();
+  while (lo < hi) {
+    uint64_t mid = lo + (hi-lo)/2;
+    if (list[mid] > pos) {
+      lo = mid+1;
+    } else {
+      hi = mid;
     }
-    if (start_node == graph.size()) {  // Next sequenze could not be found
-      // Check if graph is now empty
-      for (uint64_t i = 0; i < graph.size(); ++i) {
-        if (graph[i].adj_list.size() || graph[i].pos_list.size()) {
-          cerr << "Graph is not empty after covering " << sequenzes.size() << " sequenzes" << endl;
-          cerr << "node " << i << " has " << graph[i].adj_list.size() << " outgoing edges and " << graph[i].pos_list.size() << " entry points" << endl;
-          return false;
-        }
+  }
+  return (lo < list.size() && list[lo] == pos) ? lo : list.size();
+}
+
+
+// Last entry of a sequence: entries without an edge end a sequence
+struct sequence_end
+{
+  uint64_t pos;
+  uint64_t node;
+  uint64_t end;  // pos + len, i.e. the start of the next sequence
+  bool operator<(const sequence_end& e) const
+  {
+    return pos < e.pos;
+  }
+};
+
+
+// Collects the ends of all sequences in text order; the first sequence
+// starts at position 1 and every other one right after the previous end
+template<class t_graph>
+bool sequence_ends(const t_graph& graph, uint64_t d, vector<sequence_end>& ends)
+{
+  ends.clear();
+  uint64_t node_number = 0;
+  for (const auto& node : graph) {
+    for (uint64_t j = node.adj_list.size(); j < node.pos_list.size(); ++j) {
+      ends.push_back({node.pos_list[j], node_number, node.pos_list[j]+node.len});
+    }
+    ++node_number;
+  }
+  if (ends.size() != d) {
+    cerr << "Graph has " << ends.size() << " sequence ends, but " << d;
+    cerr << " start nodes." << endl;
+    return false;
+  }
+  sort(ends.begin(), ends.end());
+  return true;
+}
+
+
+// Follows the sequence starting at (node, pos) along its edges and calls
+// visit(node, pos, entry, last) for each of its entries. Stops and returns
+// false if an entry is missing or visit returns false; otherwise node and
+// pos are the last entry of the sequence and visited counts its entries.
+template<class t_graph, class t_visit>
+bool follow_sequence(
+  const t_graph& graph,
+  uint64_t k,
+  uint64_t& node,
+  uint64_t& pos,
+  uint64_t& visited,
+  t_visit visit)
+{
+  while (true) {
+    const auto& v = graph[node];
+    uint64_t entry = find_position(v.pos_list, pos);
+    if (entry == v.pos_list.size()) {
+      #pragma omp critical
+      cerr << "Node " << node << " with len=" << v.len << " has no position " << pos << "." << endl;
+      return false;
+    }
+    ++visited;
+    bool last = entry >= v.adj_list.size();
+    if (!visit(node, pos, entry, last)) {
+      return false;
+    }
+    if (last) {
+      return true;
+    }
+    node = v.adj_list[entry];
+    pos += v.len - k + 1;
+  }
+}
+
+
+// Checks that the sequences starting at start_nodes cover every entry of
+// graph exactly once, with consecutive positions, and stores their lengths
+// in sequences. Position lists must be descending, as produced by
+// get_explicit_representation; sequences are checked in parallel.
+template<class t_graph>
+bool verify_graph(
+  const t_graph& graph,
+  const vector<uint64_t>& start_nodes,
+  uint64_t k,
+  vector<uint64_t>& sequences,
+  uint64_t threads=1)
+{
+  uint64_t d = start_nodes.size();
+  vector<sequence_end> ends;
+  if (!sequence_ends(graph, d, ends)) {
+    return false;
+  }
+  uint64_t entries = 0;
+  for (const auto& node : graph) {
+    entries += node.pos_list.size();
+  }
+  sequences.assign(d, 0);
+  bool ok = true;
+  uint64_t visited = 0;
+  #pragma omp parallel for schedule(dynamic) num_threads(threads) reduction(+:visited)
+  for (uint64_t j = 0; j < d; ++j) {
+    uint64_t start_pos = (j == 0) ? 1 : ends[j-1].end;
+    uint64_t node = start_nodes[j];
+    uint64_t pos = start_pos;
+    auto visit = [](uint64_t, uint64_t, uint64_t, bool) { return true; };
+    if (!follow_sequence(graph, k, node, pos, visited, visit)) {
+      #pragma omp critical
+      {
+        cerr << "Sequence " << j << " starting at node " << start_nodes[j] << " and position " << start_pos << " is broken." << endl;
+        ok = false;
       }
-      done = true;
-    } else {
-      // Check current sequenze
-      uint64_t cur_node = start_node;
-      uint64_t cur_pos = start_pos;
-      while (graph[cur_node].adj_list.size()) {
-        uint64_t next_node = graph[cur_node].adj_list.back();
-        graph[cur_node].adj_list.pop_back();
-        graph[cur_node].pos_list.pop_back();
-        uint64_t next_pos = cur_pos + graph[cur_node].len - k + 1;
-        if (next_pos != graph[next_node].pos_list.back()) {
-          cerr << "I was at node " << cur_node << " with len=" << graph[cur_node].len << " at position " << cur_pos << " and walked to node " << next_node << " - but could not find the position " << next_pos << " but found " << graph[next_node].pos_list.back() << " instead." << endl;
-          return false;
-        }
-        cur_node = next_node;
-        cur_pos = next_pos;
+    } else if (node != ends[j].node || pos != ends[j].pos) {
+      #pragma omp critical
+      {
+        cerr << "Sequence " << j << " ends at node " << node << " and position " << pos << " instead of node " << ends[j].node << " and position " << ends[j].pos << "." << endl;
+        ok = false;
       }
-      // Enter last node and setup for next sequenze
-      graph[cur_node].pos_list.pop_back();
-      cur_pos += graph[cur_node].len;
-      sequenzes.emplace_back(cur_pos - start_pos);
-      start_pos = cur_pos;
     }
+    sequences[j] = ends[j].end - start_pos;
   }
-  return true;
+  if (ok && visited != entries) {
+    cerr << "Graph is not empty after covering " << d << " sequenzes: ";
+    cerr << entries - visited << " entry points are left" << endl;
+    ok = false;
+  }
+  return ok;
 }
 
 
-template<class t_node>
-vector<uint8_t> restore_text(
-  vector<t_node> graph,
-  const vector<uint8_t>& text,
-  uint64_t k) // call-by-value
+// Checks that spelling the sequences of a verified graph with the node
+// labels of g gives the text in text_file (the cached KEY_TEXT). Only the
+// characters of a node occurrence up to the next one are spelled, so every
+// text position takes one step. Every thread streams the parts of the text of
+// its sequences through its own buffer.
+template<class t_cdbg, class t_graph>
+bool verify_text(
+  const t_cdbg& g,
+  const t_graph& graph,
+  const vector<uint64_t>& start_nodes,
+  const string& text_file,
+  uint64_t threads=1)
 {
-  vector<uint8_t> res;
-  vector<uint64_t> sequenzes;
-  res.reserve(text.size());
-  uint64_t start_pos = 1;
-  bool done = false;
-  while (!done) {
-    // Search node start with position start_pos
-    uint64_t start_node=graph.size();
-    for (uint64_t i = 0; i < graph.size(); ++i) {
-      if (graph[i].pos_list.size() > 0 && graph[i].pos_list.back() == start_pos) {
-        start_node = i;
-        break;
+  uint64_t d = start_nodes.size();
+  uint64_t k = g.get_k();
+  vector<sequence_end> ends;
+  if (!sequence_ends(graph, d, ends)) {
+    return false;
+  }
+  bool ok = true;
+  #pragma omp parallel num_threads(threads)
+  {
+    int_vector_buffer<8> text(text_file);
+    #pragma omp single
+    if (d > 0 && ends[d-1].end-1 != text.size()) {
+      #pragma omp critical
+      {
+        cerr << "Graph spells " << ends[d-1].end-1 << " characters, but the text has ";
+        cerr << text.size() << "." << endl;
+        ok = false;
       }
     }
-    if (start_node == graph.size()) {  // Next sequenze could not be found
-      // Check if graph is now empty
-      for (uint64_t i = 0; i < graph.size(); ++i) {
-        if (graph[i].adj_list.size() || graph[i].pos_list.size()) {
-          cerr << "Graph is not empty after covering " << sequenzes.size() << " sequenzes" << endl;
-          cerr << "node " << i << " has " << graph[i].adj_list.size() << " outgoing edges and " << graph[i].pos_list.size() << " entry points" << endl;
-          res.resize(0);
-          return res;
+    #pragma omp for schedule(dynamic)
+    for (uint64_t j = 0; j < d; ++j) {
+      uint64_t node = start_nodes[j];
+      uint64_t pos = (j == 0) ? 1 : ends[j-1].end;
+      uint64_t visited = 0;
+      auto visit = [&](uint64_t v, uint64_t p, uint64_t, bool last) {
+        uint64_t len = graph[v].len;
+        uint64_t chars = last ? len-1 : len-k+1;
+        string label = g.node_sequence(v, chars);
+        bool same = label.size() >= chars && p-1+chars < text.size();
+        for (uint64_t i = 0; same && i < chars; ++i) {
+          same = (uint8_t)label[i] == (uint8_t)text[p-1+i];
         }
-      }
-      res.emplace_back(0);
-      done = true;
-    } else {
-      if (res.size()) {
-        res.emplace_back(1);
-      }
-      // Check current sequenze
-      uint64_t cur_node = start_node;
-      uint64_t cur_pos = start_pos;
-      while (graph[cur_node].adj_list.size()) {
-        uint64_t next_node = graph[cur_node].adj_list.back();
-        graph[cur_node].adj_list.pop_back();
-        graph[cur_node].pos_list.pop_back();
-        uint64_t next_pos = cur_pos + graph[cur_node].len - k + 1;
-        if (next_pos != graph[next_node].pos_list.back()) {
-          cerr << "I was at node " << cur_node << " with len=" << graph[cur_node].len << " at position " << cur_pos << " and walked to node " << next_node << " - but could not find the position " << next_pos << " but found " << graph[next_node].pos_list.back() << " instead." << endl;
-          res.resize(1);
-          return res;
+        if (same && last) {
+          same = (uint8_t)text[p-1+chars] <= 1;
         }
-        // Restore Text
-        uint64_t text_pos = graph[cur_node].pos_list.front();
-        for (uint64_t i = 0; i < graph[cur_node].len-k+1; ++i) {
-          res.emplace_back(text[text_pos-1+i]);
+        if (!same) {
+          #pragma omp critical
+          cerr << "Label of node " << v << " does not match the text at position " << p << "." << endl;
         }
-        cur_node = next_node;
-        cur_pos = next_pos;
-      }
-      // Restore Text
-      uint64_t text_pos = graph[cur_node].pos_list.front();
-      for (uint64_t i = 0; i < graph[cur_node].len-1; ++i) {
-        res.emplace_back(text[text_pos-1+i]);
+        return same;
+      };
+      if (!follow_sequence(graph, k, node, pos, visited, visit)) {
+        #pragma omp critical
+        ok = false;
       }
-      // Enter last node and setup for next sequenze
-      graph[cur_node].pos_list.pop_back();
-      cur_pos += graph[cur_node].len;
-      sequenzes.emplace_back(cur_pos - start_pos);
-      start_pos = cur_pos;
     }
   }
-  return res;
+  return ok;
 }
 
 
@@ -1,20 +1,35 @@
 // std
+#include <algorithm>  // max
 #include <iomanip>  // setw
 #include <iostream>  // endl, left;
-#include <string>
+#include <string>  // stoi, stoull, string
+#include <thread>  // thread
 // GNU
 #include <getopt.h>  // getopt_long, no_argument, option, required_argument
 // local
+#include "cdbg/kmer_index.hpp"  // min_kmer_fingerprint_bits
+#include "commands/bubbles.hpp"
+#include "commands/compress.hpp"
 #include "commands/construct.hpp"
+#include "commands/coordinates.hpp"
+#include "commands/extract.hpp"
 #include "commands/find_pattern.hpp"
 #include "commands/impl2expl.hpp"
+#include "commands/impl2gfa.hpp"
+#include "commands/locate.hpp"
 #include "commands/print_graph_details.hpp"
+#include "commands/space.hpp"
+#include "memory_plan.hpp"
 
 using std::cerr;
 using std::endl;
 using std::left;
+using std::max;
 using std::setw;
+using std::stoi;
+using std::stoull;
 using std::string;
+using std::thread;
 
 
 struct options_t {
@@ -23,6 +38,23 @@ struct options_t {
   string kfile;
   string graphfile;
   string patternfile;
+  uint64_t threads = 0;
+  bool stream = false;
+  uint64_t buffer_size = 256;  // MiB
+  bool verify = false;
+  string sequences;  // comma separated sequence ids
+  uint64_t sa_sample_rate = 0;
+  string regionfile;
+  string profile;  // bv, or chosen by the memory budget
+  bool bidirectional = false;
+  uint64_t checkpoint_rate = 0;
+  uint64_t document_sample_rate = 0;
+  uint64_t color_threshold = 0;
+  string memory_budget;
+  uint64_t max_depth = 32;  // nodes
+  bool with_document_array = true;
+  int compress_level = -1;  // zstd level, -1: the command's default
+  int kmer_fingerprint_bits = -1;  // -1: the command's default
 };
 
 
@@ -47,8 +79,17 @@ void usage(const string& program, const string& command="")
     cerr << "Where command must be one of the following list:" << endl;
     print_command("construct", " - Construct the compressed de bruijn graph");
     print_command("print_graph_details", " - Print graph details");
+    print_command("space", " - Report the space of every graph component");
     print_command("find_pattern", " - Finding pattern in the pan-genome");
+    print_command("locate", " - Locate pattern occurrences in the sequences");
+    print_command("index_coordinates", " - Index sequence coordinates for find_region");
+    print_command("index_kmers", " - Index the kmers of a graph for find_pattern");
+    print_command("find_region", " - Find the nodes covering sequence regions");
     print_command("impl2expl", " - Convert to explicit representation");
+    print_command("impl2gfa", " - Convert to GFA");
+    print_command("extract", " - Rebuild the input sequences from the graph");
+    print_command("bubbles", " - Report the bubbles (variant sites) of the graph");
+    print_command("compress", " - Write a graph as a compressed graph file");
   } else {
     cerr << command << " options" << endl;
     cerr << endl;
@@ -56,16 +97,84 @@ void usage(const string& program, const string& command="")
       print_option("-i, --inputfile=INFILE", "the input file");
       print_option("-o, --outputfile=OUTFILE", "the output file");
       print_option("-k, --kfile=KFILE", "text file containing k values");
+      print_option("-v, --verify", "check every graph against the input");
+      print_option("-t, --threads=THREADS", "number of threads for --verify and --compress (default: all cores)");
+      print_option("-r, --samplerate=RATE", "sample every RATE-th suffix array value for locate (default: 0, none)");
+      print_option("-f, --profile=PROFILE", "succinct backends: bv (default), sd, rrr (smallest) or dna (fastest, ACGNT only)");
+      print_option("-d, --bidirectional", "add a successor index for forward navigation");
+      print_option("-c, --checkpoints=RATE", "bound pattern search to RATE steps per node (default: 0, unbounded)");
+      print_option("-a, --document-samples=RATE", "sample the sequence ids of every RATE-th position instead of storing all (default: 0, all)");
+      print_option("-u, --colors=OCC", "with -a, store the sequence ids of nodes occurring OCC or more times (default: 0, none)");
+      print_option("-m, --memory-budget=SIZE", "plan construction to stay within SIZE bytes (suffixes K, M, G, T), fail early otherwise; picks the profile unless --profile is given");
+      print_option("-n, --no-document-array", "do not store the sequence ids of nodes (no find_pattern documents)");
+      print_option("-z, --compress=LEVEL", "write compressed graph files at zstd level LEVEL (default: 0, uncompressed)");
+      print_option("-x, --kmer-index=BITS", "also write a kmer index with BITS (at least 8) bit fingerprints to OUTFILE.kK.bin.kmers (default: none)");
     } else if(command == "print_graph_details") {
       print_option("-g, --graphfile=GRAPHFILE", "graph file, created via construct command");
+    } else if(command == "space") {
+      cerr << "Program will print JSON, or create OUTFILE.json and OUTFILE.html" << endl;
+      cerr << endl;
+      print_option("-g, --graphfile=GRAPHFILE", " graph file, created via construct command");
+      print_option("-o, --outputfile=OUTFILE", " the output file (optional)");
     } else if(command == "find_pattern") {
       print_option("-g, --graphfile=GRAPHFILE", " graph file, created via construct command");
       print_option("-p, --patternfile=PATTERNFILE", " pattern file, containing pattern");
+      print_option("-n, --no-document-array", " list the nodes only; the document array is not loaded");
+      cerr << endl;
+      cerr << "Patterns of length k are looked up in GRAPHFILE.kmers if it exists" << endl;
+    } else if(command == "locate") {
+      print_option("-g, --graphfile=GRAPHFILE", " graph file, created via construct command with --samplerate");
+      print_option("-p, --patternfile=PATTERNFILE", " pattern file, containing pattern");
+    } else if(command == "index_coordinates") {
+      cerr << "Program will create GRAPHFILE.coords" << endl;
+      cerr << endl;
+      print_option("-g, --graphfile=GRAPHFILE", " graph file, created via construct command");
+      print_option("-r, --samplerate=RATE", " text positions per checkpoint (default: 1024)");
+      print_option("-t, --threads=THREADS", " number of threads (default: all cores)");
+    } else if(command == "index_kmers") {
+      cerr << "Program will create GRAPHFILE.kmers" << endl;
+      cerr << endl;
+      print_option("-g, --graphfile=GRAPHFILE", " graph file, created via construct command");
+      print_option("-x, --kmer-index=BITS", " fingerprint bits, at least 8; absent kmers are reported with probability 2^-BITS (default: 16)");
+      print_option("-t, --threads=THREADS", " number of threads (default: all cores)");
+    } else if(command == "find_region") {
+      print_option("-g, --graphfile=GRAPHFILE", " graph file with GRAPHFILE.coords, created via index_coordinates");
+      print_option("-e, --regionfile=REGIONFILE", " region file, containing 'sequence begin end' per line");
     } else if(command == "impl2expl") {
       cerr << "Program will create OUTFILE.dot and OUTFILE.start_nodes.txt" << endl;
       cerr << endl;
       print_option("-g, --graphfile=GRAPHFILE", " graph file, created via construct command");
       print_option("-o, --outputfile=OUTFILE", " the output file");
+      print_option("-t, --threads=THREADS", " number of threads (default: all cores)");
+      print_option("-s, --stream", " write while traversing, without building the graph in memory");
+      print_option("-b, --buffersize=MIB", " buffer size of the streaming mode (default: 256)");
+    } else if(command == "impl2gfa") {
+      cerr << "Program will create OUTFILE.gfa" << endl;
+      cerr << endl;
+      print_option("-g, --graphfile=GRAPHFILE", " graph file, created via construct command");
+      print_option("-o, --outputfile=OUTFILE", " the output file");
+      print_option("-t, --threads=THREADS", " number of threads (default: all cores)");
+    } else if(command == "extract") {
+      cerr << "Program will create OUTFILE.fa" << endl;
+      cerr << endl;
+      print_option("-g, --graphfile=GRAPHFILE", " graph file, created via construct command");
+      print_option("-o, --outputfile=OUTFILE", " the output file");
+      print_option("-q, --sequences=IDS", " comma separated sequence ids (default: all)");
+      print_option("-t, --threads=THREADS", " number of threads (default: all cores)");
+    } else if(command == "bubbles") {
+      cerr << "Program will print TSV, or create OUTFILE.tsv" << endl;
+      cerr << endl;
+      print_option("-g, --graphfile=GRAPHFILE", " graph file, created via construct command");
+      print_option("-o, --outputfile=OUTFILE", " the output file (optional)");
+      print_option("-l, --depth=NODES", " longest branch in nodes (default: 32)");
+      print_option("-t, --threads=THREADS", " number of threads (default: all cores)");
+    } else if(command == "compress") {
+      cerr << "Program will create OUTFILE.bin and print its table of contents" << endl;
+      cerr << endl;
+      print_option("-g, --graphfile=GRAPHFILE", " graph file, created via construct command");
+      print_option("-o, --outputfile=OUTFILE", " the output file");
+      print_option("-z, --compress=LEVEL", " zstd level, 1 (fastest) to 19 (default: 3); 0 writes an uncompressed graph file");
+      print_option("-t, --threads=THREADS", " number of threads (default: all cores)");
     }
   }
   cerr << endl;
@@ -91,14 +200,64 @@ void call_construct(const string& program, const options_t& opts)
   check_argument_given(program, "construct", opts.inputfile, "inputfile");
   check_argument_given(program, "construct", opts.outputfile, "outputfile");
   check_argument_given(program, "construct", opts.kfile, "kfile");
-  cdbg::commands::construct(opts.inputfile, opts.outputfile, opts.kfile, true);
+  cdbg::commands::construct_options construct_opts;
+  if (!opts.profile.empty() &&
+      !cdbg::parse_profile(opts.profile, construct_opts.graph_profile)) {
+    usage(program, "construct");
+    cerr << "ERROR: Unknown profile '" << opts.profile << "'." << endl;
+    exit(EXIT_FAILURE);
+  }
+  if (!opts.memory_budget.empty()) {
+    if (!cdbg::parse_memory_size(opts.memory_budget, construct_opts.memory_budget) ||
+        construct_opts.memory_budget == 0) {
+      usage(program, "construct");
+      cerr << "ERROR: Invalid memory budget '" << opts.memory_budget << "'." << endl;
+      exit(EXIT_FAILURE);
+    }
+    construct_opts.choose_profile = opts.profile.empty();
+  }
+  construct_opts.with_document_array = opts.with_document_array;
+  construct_opts.document_sample_rate = opts.document_sample_rate;
+  construct_opts.color_threshold = opts.color_threshold;
+  construct_opts.verify = opts.verify;
+  construct_opts.threads = opts.threads;
+  construct_opts.sa_sample_rate = opts.sa_sample_rate;
+  construct_opts.bidirectional = opts.bidirectional;
+  construct_opts.checkpoint_rate = opts.checkpoint_rate;
+  construct_opts.compress_level = (opts.compress_level > 0) ? opts.compress_level : 0;
+  if (opts.kmer_fingerprint_bits >= 0 &&
+      opts.kmer_fingerprint_bits < (int)cdbg::min_kmer_fingerprint_bits) {
+    usage(program, "construct");
+    cerr << "ERROR: A kmer index needs at least " << cdbg::min_kmer_fingerprint_bits;
+    cerr << " fingerprint bits." << endl;
+    exit(EXIT_FAILURE);
+  }
+  construct_opts.kmer_fingerprint_bits = opts.kmer_fingerprint_bits;
+  if (!cdbg::commands::construct(
+        opts.inputfile,
+        opts.outputfile,
+        opts.kfile,
+        construct_opts)) {
+    exit(1);
+  }
 }
 
 
 void call_print_graph_details(const string& program, const options_t& opts)
 {
   check_argument_given(program, "print_graph_details", opts.graphfile, "graphfile");
-  cdbg::commands::print_graph_details(opts.graphfile);
+  if (!cdbg::commands::print_graph_details(opts.graphfile)) {
+    exit(1);
+  }
+}
+
+
+void call_space(const string& program, const options_t& opts)
+{
+  check_argument_given(program, "space", opts.graphfile, "graphfile");
+  if (!cdbg::commands::space(opts.graphfile, opts.outputfile)) {
+    exit(1);
+  }
 }
 
 
@@ -106,7 +265,55 @@ void call_find_pattern(const string& program, const options_t& opts)
 {
   check_argument_given(program, "find_pattern", opts.graphfile, "graphfile");
   check_argument_given(program, "find_pattern", opts.patternfile, "patternfile");
-  cdbg::commands::find_pattern(opts.graphfile, opts.patternfile);
+  if (!cdbg::commands::find_pattern(opts.graphfile, opts.patternfile, opts.with_document_array)) {
+    exit(1);
+  }
+}
+
+
+void call_locate(const string& program, const options_t& opts)
+{
+  check_argument_given(program, "locate", opts.graphfile, "graphfile");
+  check_argument_given(program, "locate", opts.patternfile, "patternfile");
+  if (!cdbg::commands::locate(opts.graphfile, opts.patternfile)) {
+    exit(1);
+  }
+}
+
+
+void call_index_coordinates(const string& program, const options_t& opts)
+{
+  check_argument_given(program, "index_coordinates", opts.graphfile, "graphfile");
+  uint64_t rate = opts.sa_sample_rate ? opts.sa_sample_rate : 1024;
+  if (!cdbg::commands::index_coordinates(opts.graphfile, rate, opts.threads)) {
+    exit(1);
+  }
+}
+
+
+void call_index_kmers(const string& program, const options_t& opts)
+{
+  check_argument_given(program, "index_kmers", opts.graphfile, "graphfile");
+  uint64_t bits = (opts.kmer_fingerprint_bits >= 0) ? opts.kmer_fingerprint_bits : 16;
+  if (bits < cdbg::min_kmer_fingerprint_bits) {
+    usage(program, "index_kmers");
+    cerr << "ERROR: A kmer index needs at least " << cdbg::min_kmer_fingerprint_bits;
+    cerr << " fingerprint bits." << endl;
+    exit(EXIT_FAILURE);
+  }
+  if (!cdbg::commands::index_kmers(opts.graphfile, bits, opts.threads)) {
+    exit(1);
+  }
+}
+
+
+void call_find_region(const string& program, const options_t& opts)
+{
+  check_argument_given(program, "find_region", opts.graphfile, "graphfile");
+  check_argument_given(program, "find_region", opts.regionfile, "regionfile");
+  if (!cdbg::commands::find_region(opts.graphfile, opts.regionfile)) {
+    exit(1);
+  }
 }
 
 
@@ -114,7 +321,60 @@ void call_impl2expl(const string& program, const options_t& opts)
 {
   check_argument_given(program, "impl2expl", opts.graphfile, "graphfile");
   check_argument_given(program, "impl2expl", opts.outputfile, "outputfile");
-  if (!cdbg::commands::impl2expl(opts.graphfile, opts.outputfile)) {
+  if (!cdbg::commands::impl2expl(
+        opts.graphfile,
+        opts.outputfile,
+        opts.threads,
+        opts.stream,
+        opts.buffer_size << 20)) {
+    exit(1);
+  }
+}
+
+
+void call_impl2gfa(const string& program, const options_t& opts)
+{
+  check_argument_given(program, "impl2gfa", opts.graphfile, "graphfile");
+  check_argument_given(program, "impl2gfa", opts.outputfile, "outputfile");
+  if (!cdbg::commands::impl2gfa(opts.graphfile, opts.outputfile, opts.threads)) {
+    exit(1);
+  }
+}
+
+
+void call_extract(const string& program, const options_t& opts)
+{
+  check_argument_given(program, "extract", opts.graphfile, "graphfile");
+  check_argument_given(program, "extract", opts.outputfile, "outputfile");
+  if (!cdbg::commands::extract(
+        opts.graphfile,
+        opts.outputfile,
+        opts.sequences,
+        opts.threads)) {
+    exit(1);
+  }
+}
+
+
+void call_bubbles(const string& program, const options_t& opts)
+{
+  check_argument_given(program, "bubbles", opts.graphfile, "graphfile");
+  if (!cdbg::commands::bubbles(
+        opts.graphfile,
+        opts.outputfile,
+        opts.max_depth,
+        opts.threads)) {
+    exit(1);
+  }
+}
+
+
+void call_compress(const string& program, const options_t& opts)
+{
+  check_argument_given(program, "compress", opts.graphfile, "graphfile");
+  check_argument_given(program, "compress", opts.outputfile, "outputfile");
+  int level = (opts.compress_level >= 0) ? opts.compress_level : 3;
+  if (!cdbg::commands::compress(opts.graphfile, opts.outputfile, level, opts.threads)) {
     exit(1);
   }
 }
@@ -123,7 +383,7 @@ void call_impl2expl(const string& program, const options_t& opts)
 options_t parse_args(int argc, char* argv[])
 {
   options_t opts;
-  const char* const short_opts = "i:o:k:g:p:h";
+  const char* const short_opts = "i:o:k:g:p:t:sb:vq:r:e:f:dc:a:u:m:nl:z:x:h";
   static struct option long_opts[] =
   {
     {"inputfile", required_argument, nullptr, 'i'},
@@ -131,6 +391,23 @@ options_t parse_args(int argc, char* argv[])
     {"kfile", required_argument, nullptr, 'k'},
     {"graphfile", required_argument, nullptr, 'g'},
     {"patternfile", required_argument, nullptr, 'p'},
+    {"threads", required_argument, nullptr, 't'},
+    {"stream", no_argument, nullptr, 's'},
+    {"buffersize", required_argument, nullptr, 'b'},
+    {"verify", no_argument, nullptr, 'v'},
+    {"sequences", required_argument, nullptr, 'q'},
+    {"samplerate", required_argument, nullptr, 'r'},
+    {"regionfile", required_argument, nullptr, 'e'},
+    {"profile", required_argument, nullptr, 'f'},
+    {"bidirectional", no_argument, nullptr, 'd'},
+    {"checkpoints", required_argument, nullptr, 'c'},
+    {"document-samples", required_argument, nullptr, 'a'},
+    {"colors", required_argument, nullptr, 'u'},
+    {"memory-budget", required_argument, nullptr, 'm'},
+    {"no-document-array", no_argument, nullptr, 'n'},
+    {"depth", required_argument, nullptr, 'l'},
+    {"compress", required_argument, nullptr, 'z'},
+    {"kmer-index", required_argument, nullptr, 'x'},
     {"help", no_argument, nullptr, 'h'},
     {nullptr, no_argument, nullptr, 0}
   };
@@ -152,11 +429,65 @@ options_t parse_args(int argc, char* argv[])
       case 'p':
         opts.patternfile = string(optarg);
         break;
+      case 't':
+        opts.threads = stoull(optarg);
+        break;
+      case 's':
+        opts.stream = true;
+        break;
+      case 'b':
+        opts.buffer_size = stoull(optarg);
+        break;
+      case 'v':
+        opts.verify = true;
+        break;
+      case 'q':
+        opts.sequences = string(optarg);
+        break;
+      case 'r':
+        opts.sa_sample_rate = stoull(optarg);
+        break;
+      case 'e':
+        opts.regionfile = string(optarg);
+        break;
+      case 'f':
+        opts.profile = string(optarg);
+        break;
+      case 'd':
+        opts.bidirectional = true;
+        break;
+      case 'c':
+        opts.checkpoint_rate = stoull(optarg);
+        break;
+      case 'a':
+        opts.document_sample_rate = stoull(optarg);
+        break;
+      case 'u':
+        opts.color_threshold = stoull(optarg);
+        break;
+      case 'm':
+        opts.memory_budget = string(optarg);
+        break;
+      case 'n':
+        opts.with_document_array = false;
+        break;
+      case 'l':
+        opts.max_depth = stoull(optarg);
+        break;
+      case 'z':
+        opts.compress_level = stoi(optarg);
+        break;
+      case 'x':
+        opts.kmer_fingerprint_bits = stoi(optarg);
+        break;
       default:
         usage(argv[0], argv[1]);
         break;
     }
   }
+  if (opts.threads == 0) {
+    opts.threads = max(1u, thread::hardware_concurrency());
+  }
   return opts;
 }
 
@@ -172,10 +503,28 @@ int main(int argc, char* argv[]) {
     call_construct(argv[0], opts);
   } else if (command == "print_graph_details") {
     call_print_graph_details(argv[0], opts);
+  } else if (command == "space") {
+    call_space(argv[0], opts);
   } else if (command == "find_pattern") {
     call_find_pattern(argv[0], opts);
+  } else if(command == "locate") {
+    call_locate(argv[0], opts);
+  } else if(command == "index_coordinates") {
+    call_index_coordinates(argv[0], opts);
+  } else if(command == "index_kmers") {
+    call_index_kmers(argv[0], opts);
+  } else if(command == "find_region") {
+    call_find_region(argv[0], opts);
   } else if(command == "impl2expl") {
     call_impl2expl(argv[0], opts);
+  } else if(command == "impl2gfa") {
+    call_impl2gfa(argv[0], opts);
+  } else if(command == "extract") {
+    call_extract(argv[0], opts);
+  } else if(command == "bubbles") {
+    call_bubbles(argv[0], opts);
+  } else if(command == "compress") {
+    call_compress(argv[0], opts);
   } else {
     usage(argv[0], command);
     return 1;
@@ -0,0 +1,282 @@
+// std
+#include <algorithm>  // max, min
+#include <cmath>  // log2
+#include <cstdio>  // snprintf
+#include <fstream>  // ifstream
+#include <initializer_list>
+#include <iomanip>  // left, setw
+#include <iostream>  // cerr, endl, ostream
+#include <string>
+#include <vector>
+// sdsl
+#include <sdsl/config.hpp>  // sdsl::conf, cache_config
+#include <sdsl/int_vector_buffer.hpp>  // int_vector_buffer
+#include <sdsl/io.hpp>  // cache_file_name
+// local
+#include "cdbg/cdbg.hpp"  // node_c, profile, profile_name, small_alphabet_bwt
+#include "memory_plan.hpp"  // memory_plan, phase_estimate, text_statistics
+
+
+using std::cerr;
+using std::endl;
+using std::ifstream;
+using std::left;
+using std::log2;
+using std::max;
+using std::min;
+using std::ostream;
+using std::setw;
+using std::string;
+using std::to_string;
+using std::vector;
+using sdsl::cache_config;
+using sdsl::cache_file_name;
+using sdsl::int_vector_buffer;
+
+
+namespace cdbg {
+
+
+static uint64_t bit_width(uint64_t x)
+{
+  uint64_t width = 1;
+  while (x >>= 1) {
+    ++width;
+  }
+  return width;
+}
+
+
+// Bits per character of the BWT structure of profile p for a text of n
+// characters, including the rank and select support of its bit vectors
+static double bwt_bits(profile p, uint64_t sigma, uint64_t n)
+{
+  double entropy = log2(max<uint64_t>(sigma, 2));
+  switch (p) {
+    case profile::rrr:
+      return 0.75*entropy;
+    case profile::dna:
+      return (double)small_alphabet_bwt<>::size_in_bits(n)/max<uint64_t>(n, 1);
+    default:
+      return 1.5*entropy;
+  }
+}
+
+
+// A guess, since the nodes are only known once the graph is built: a node is
+// defined by a distinct kmer, and in collections of related sequences kmers
+// rarely branch more than every k characters
+static uint64_t estimate_nodes(const text_statistics& stats, uint64_t k)
+{
+  uint64_t base = max<uint64_t>(stats.sigma, 4) - 2;  // without sentinels
+  uint64_t kmers = 1;
+  for (uint64_t i = 0; i < k && kmers < stats.length; ++i) {
+    kmers *= base;
+  }
+  return min(2*kmers, stats.length/max<uint64_t>(k, 1)) + stats.sequences;
+}
+
+
+// Of the documents while the graph is built: the wavelet tree of the
+// document array, or the loaded document array and the marks of its samples
+static uint64_t estimate_documents(const text_statistics& stats, uint64_t document_sample_rate)
+{
+  uint64_t n = stats.length;
+  uint64_t width = bit_width(stats.sequences-1);
+  if (document_sample_rate == 0) {
+    return 2*(n*width*5/32);
+  }
+  return n*width/8 + n/8 + n/document_sample_rate*width/8;
+}
+
+
+// The graph constructor in order: partial LCP array (2 bits per character)
+// and its interval bit vectors, node detection with dense bv1 and bv3, node
+// completion and the documents, which are built while the nodes are still
+// held
+static uint64_t estimate_graph_phase(
+  const text_statistics& stats,
+  uint64_t k,
+  profile p,
+  bool with_document_array,
+  uint64_t document_sample_rate)
+{
+  uint64_t n = stats.length;
+  uint64_t nodes = estimate_nodes(stats, k);
+  uint64_t bwt = n*bwt_bits(p, stats.sigma, n)/8;
+  uint64_t lcp = n/4;
+  uint64_t frontier = n/4;
+  uint64_t dense_bvs = n/4;
+  uint64_t node_vector = nodes*sizeof(node_c);
+  uint64_t node_table = nodes*3*bit_width(n)/8;
+  uint64_t bvs = dense_bvs;
+  if (p == profile::sd || p == profile::rrr) {
+    bvs = nodes*(2+bit_width(n/nodes))/4;
+  }
+  uint64_t documents = 0;
+  if (with_document_array) {
+    documents = estimate_documents(stats, document_sample_rate);
+  }
+  uint64_t peak = bwt + lcp + frontier;
+  peak = max(peak, bwt + lcp + dense_bvs + node_vector);
+  peak = max(peak, bwt + bvs + node_vector + node_table + documents);
+  return peak;
+}
+
+
+bool parse_memory_size(const string& size, uint64_t& bytes)
+{
+  uint64_t value = 0;
+  uint64_t i = 0;
+  for (; i < size.size() && size[i] >= '0' && size[i] <= '9'; ++i) {
+    value = 10*value + (size[i]-'0');
+  }
+  if (i == 0 || i+1 < size.size()) {
+    return false;
+  }
+  uint64_t shift = 0;
+  if (i < size.size()) {
+    switch (size[i]) {
+      case 'K': case 'k':
+        shift = 10;
+        break;
+      case 'M': case 'm':
+        shift = 20;
+        break;
+      case 'G': case 'g':
+        shift = 30;
+        break;
+      case 'T': case 't':
+        shift = 40;
+        break;
+      default:
+        return false;
+    }
+  }
+  bytes = value << shift;
+  return true;
+}
+
+
+string format_memory_size(uint64_t bytes)
+{
+  const char* units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+  double size = bytes;
+  uint64_t unit = 0;
+  while (size >= 1024 && unit < 4) {
+    size /= 1024;
+    ++unit;
+  }
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%.1f %s", size, units[unit]);
+  return string(buffer);
+}
+
+
+// create_text loads the whole input file and compacts it in place
+uint64_t estimate_text_phase(const string& inputfile)
+{
+  ifstream in(inputfile, std::ios::binary | std::ios::ate);
+  return in ? (uint64_t)in.tellg() : 0;
+}
+
+
+text_statistics get_text_statistics(
+  const cache_config& config,
+  const vector<uint64_t>& sequences)
+{
+  text_statistics stats;
+  int_vector_buffer<8> text(cache_file_name(sdsl::conf::KEY_TEXT, config));
+  vector<bool> occurs(256, false);
+  for (uint64_t i = 0; i < text.size(); ++i) {
+    occurs[text[i]] = true;
+  }
+  stats.length = text.size();
+  for (const auto& o : occurs) {
+    stats.sigma += o;
+  }
+  stats.sequences = sequences.size();
+  return stats;
+}
+
+
+void print_memory_plan(
+  ostream& out,
+  const memory_plan& plan,
+  const text_statistics& stats)
+{
+  out << "Memory plan for n=" << stats.length << ", sigma=" << stats.sigma;
+  out << ", d=" << stats.sequences << " and a budget of ";
+  out << format_memory_size(plan.budget) << ":" << endl;
+  for (const auto& estimate : plan.phases) {
+    out << "  " << setw(34) << left << estimate.phase;
+    out << format_memory_size(estimate.bytes) << endl;
+  }
+}
+
+
+// Fills plan.phases for the smallest k (the most nodes) and prints them.
+// Picks divsufsort if it fits plan.budget (SE-SAIS otherwise) and, if
+// choose_profile, the fastest profile whose graph fits. False (with a
+// message) if a phase does not fit.
+bool plan_construction(
+  const text_statistics& stats,
+  uint64_t k,
+  bool with_document_array,
+  uint64_t document_sample_rate,
+  bool choose_profile,
+  memory_plan& plan)
+{
+  uint64_t n = stats.length;
+  uint64_t sa_width = bit_width(n);
+  // divsufsort sorts into 32 or 64 bit integers, SE-SAIS writes bit-packed
+  uint64_t sa_fast = n + n*((n < (1ULL << 31)) ? 4 : 8);
+  uint64_t sa_small = n + n*sa_width/8 + n/4;
+  plan.fast_sa = (sa_fast <= plan.budget);
+  plan.phases.clear();
+  plan.phases.push_back({"text", n});
+  if (plan.fast_sa) {
+    plan.phases.push_back({"suffix array (divsufsort)", sa_fast});
+  } else {
+    plan.phases.push_back({"suffix array (SE-SAIS)", sa_small});
+  }
+  plan.phases.push_back({"BWT", n});
+  if (with_document_array) {
+    plan.phases.push_back({"document array",
+      n*bit_width(stats.sequences-1)/8 + 8*stats.sequences});
+  }
+  if (choose_profile) {
+    for (const auto& p : {profile::bv, profile::sd, profile::rrr}) {
+      plan.graph_profile = p;
+      if (estimate_graph_phase(stats, k, p, with_document_array, document_sample_rate) <= plan.budget) {
+        break;
+      }
+    }
+  }
+  uint64_t graph = estimate_graph_phase(stats, k, plan.graph_profile, with_document_array,
+                                        document_sample_rate);
+  plan.phases.push_back({"graph (profile " + profile_name(plan.graph_profile) +
+    ", k=" + to_string(k) + ")", graph});
+  print_memory_plan(cerr, plan, stats);
+  bool fits = true;
+  for (const auto& estimate : plan.phases) {
+    if (estimate.bytes > plan.budget) {
+      cerr << "The " << estimate.phase << " phase needs an estimated ";
+      cerr << format_memory_size(estimate.bytes) << ", which exceeds the memory budget of ";
+      cerr << format_memory_size(plan.budget) << "." << endl;
+      fits = false;
+    }
+  }
+  if (graph > plan.budget && with_document_array &&
+      estimate_graph_phase(stats, k, plan.graph_profile, false, 0) <= plan.budget) {
+    cerr << "Without the document array (--no-document-array) the graph would fit." << endl;
+    if (document_sample_rate == 0 &&
+        estimate_graph_phase(stats, k, plan.graph_profile, true, 64) <= plan.budget) {
+      cerr << "With document samples (--document-samples=64) it would fit as well." << endl;
+    }
+  }
+  return fits;
+}
+
+
+}  // cdbg
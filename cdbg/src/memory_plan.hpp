@@ -0,0 +1,67 @@
+#ifndef MEMORY_PLAN_HPP
+#define MEMORY_PLAN_HPP
+
+// std
+#include <iostream>  // ostream
+#include <string>
+#include <vector>
+// sdsl
+#include <sdsl/config.hpp>  // cache_config
+// local
+#include "cdbg/cdbg.hpp"  // profile
+
+
+using std::ostream;
+using std::string;
+using std::vector;
+using sdsl::cache_config;
+
+
+namespace cdbg {
+
+
+// What the estimates of a construction are based on
+struct text_statistics
+{
+  uint64_t length = 0;  // n, including the sentinels
+  uint64_t sigma = 0;  // distinct characters, including the sentinels
+  uint64_t sequences = 0;  // d
+};
+
+
+struct phase_estimate
+{
+  string phase;
+  uint64_t bytes;  // estimated peak
+};
+
+
+// The choices of construct that keep every phase within budget, and the
+// estimated peak of every phase under these choices
+struct memory_plan
+{
+  uint64_t budget = 0;
+  bool fast_sa = false;  // divsufsort instead of SE-SAIS
+  profile graph_profile = profile::bv;
+  vector<phase_estimate> phases;
+};
+
+
+bool parse_memory_size(const string&, uint64_t&);
+string format_memory_size(uint64_t);
+uint64_t estimate_text_phase(const string&);
+text_statistics get_text_statistics(const cache_config&, const vector<uint64_t>&);
+bool plan_construction(
+  const text_statistics&,
+  uint64_t,
+  bool,
+  uint64_t,
+  bool,
+  memory_plan&);
+void print_memory_plan(ostream&, const memory_plan&, const text_statistics&);
+
+
+}  // cdbg
+
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef OUTPUT_BUFFER_HPP
+#define OUTPUT_BUFFER_HPP
+
+// std
+#include <cstring>  // memcpy, strlen
+#include <iostream>  // ostream
+#include <string>
+#include <vector>
+
+
+using std::ostream;
+using std::string;
+using std::vector;
+
+
+namespace cdbg {
+
+
+// Writes the decimal representation of x to the end of the 20 character
+// buffer digits and returns the index of its first digit
+inline uint64_t format_uint(char (&digits)[20], uint64_t x)
+{
+  uint64_t i = sizeof(digits);
+  do {
+    digits[--i] = '0' + (x % 10);
+    x /= 10;
+  } while (x);
+  return i;
+}
+
+
+// Appends the decimal representation of x to out without going through
+// ostream formatting
+inline void append_uint(string& out, uint64_t x)
+{
+  char digits[20];
+  uint64_t i = format_uint(digits, x);
+  out.append(digits+i, sizeof(digits)-i);
+}
+
+
+// Collects output in a large buffer and hands it to the stream in big
+// blocks; integers are formatted by hand
+class output_buffer
+{
+  private:
+    ostream& m_out;
+    vector<char> m_buffer;
+    uint64_t m_size;
+
+    void reserve(uint64_t n)
+    {
+      if (m_size + n > m_buffer.size()) {
+        flush();
+        if (n > m_buffer.size()) {
+          m_buffer.resize(n);
+        }
+      }
+    }
+
+  public:
+    explicit output_buffer(ostream& out, uint64_t capacity=(1ULL<<23)) :
+      m_out(out), m_buffer(capacity), m_size(0) { }
+
+    ~output_buffer()
+    {
+      flush();
+    }
+
+    void write_uint(uint64_t x)
+    {
+      reserve(20);
+      char digits[20];
+      uint64_t i = format_uint(digits, x);
+      memcpy(m_buffer.data()+m_size, digits+i, sizeof(digits)-i);
+      m_size += sizeof(digits)-i;
+    }
+
+    void write(char c)
+    {
+      reserve(1);
+      m_buffer[m_size++] = c;
+    }
+
+    void write(const char* s, uint64_t n)
+    {
+      reserve(n);
+      memcpy(m_buffer.data()+m_size, s, n);
+      m_size += n;
+    }
+
+    void write(const char* s)
+    {
+      write(s, strlen(s));
+    }
+
+    void write(const string& s)
+    {
+      write(s.data(), s.size());
+    }
+
+    void flush()
+    {
+      if (m_size) {
+        m_out.write(m_buffer.data(), m_size);
+        m_size = 0;
+      }
+    }
+};
+
+
+}  // cdbg
+
+
+#endif
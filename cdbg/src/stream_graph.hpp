@@ -0,0 +1,285 @@
+#ifndef STREAM_GRAPH_HPP
+#define STREAM_GRAPH_HPP
+
+// std
+#include <algorithm>  // max, sort
+#include <cstdio>  // remove
+#include <fstream>  // ifstream, ofstream
+#include <functional>  // greater
+#include <iostream>  // cerr, endl
+#include <limits>  // numeric_limits
+#include <queue>  // priority_queue
+#include <string>  // string, to_string
+#include <utility>  // pair
+#include <vector>
+// local
+#include "output_buffer.hpp"  // output_buffer
+
+
+using std::cerr;
+using std::endl;
+using std::greater;
+using std::ifstream;
+using std::max;
+using std::numeric_limits;
+using std::ofstream;
+using std::pair;
+using std::priority_queue;
+using std::sort;
+using std::string;
+using std::to_string;
+using std::vector;
+
+
+namespace cdbg {
+
+
+// A node occurrence of the explicit graph; next is the node the occurrence
+// has an edge to (numeric_limits<uint64_t>::max() for stop nodes)
+struct occurrence
+{
+  uint64_t node;
+  uint64_t pos;
+  uint64_t next;
+  bool operator<(const occurrence& o) const
+  {
+    return node < o.node || (node == o.node && pos < o.pos);
+  }
+};
+
+
+// Reads a sorted run of occurrences back in blocks
+class run_reader
+{
+  private:
+    ifstream m_in;
+    vector<occurrence> m_block;
+    uint64_t m_idx;
+
+  public:
+    run_reader(const string& filename, uint64_t block_size) :
+      m_in(filename, std::ios::binary), m_block(block_size), m_idx(block_size) { }
+
+    bool next(occurrence& o)
+    {
+      if (m_idx == m_block.size()) {
+        m_block.resize(m_block.capacity());
+        m_in.read((char*)m_block.data(), m_block.size()*sizeof(occurrence));
+        m_block.resize(m_in.gcount()/sizeof(occurrence));
+        m_idx = 0;
+        if (m_block.empty()) {
+          return false;
+        }
+      }
+      o = m_block[m_idx++];
+      return true;
+    }
+};
+
+
+// Removes the temporary run files it holds when it goes out of scope, so
+// they do not outlive stream_graph on any return path
+class run_files
+{
+  private:
+    vector<string> m_filenames;
+
+  public:
+    run_files() = default;
+    run_files(const run_files&) = delete;
+    run_files& operator=(const run_files&) = delete;
+
+    ~run_files()
+    {
+      for (const auto& filename : m_filenames) {
+        std::remove(filename.c_str());
+      }
+    }
+
+    void add(const string& filename)
+    {
+      m_filenames.emplace_back(filename);
+    }
+
+    uint64_t size() const
+    {
+      return m_filenames.size();
+    }
+
+    bool empty() const
+    {
+      return m_filenames.empty();
+    }
+
+    const string& operator[](uint64_t i) const
+    {
+      return m_filenames[i];
+    }
+};
+
+
+// Writes occurrences sorted by (node, pos) in the format of print_graph
+template<class t_cdbg>
+class dot_writer
+{
+  private:
+    const t_cdbg& m_g;
+    output_buffer m_out;
+    uint64_t m_node;
+    vector<uint64_t> m_edges;
+
+    void finish_node()
+    {
+      if (m_node == numeric_limits<uint64_t>::max()) {
+        return;
+      }
+      m_out.write(':');
+      m_out.write_uint(m_g.node_length(m_node));
+      m_out.write("\"]\n");
+      for (const auto& next : m_edges) {
+        m_out.write("  ");
+        m_out.write_uint(m_node);
+        m_out.write(" -> ");
+        m_out.write_uint(next);
+        m_out.write('\n');
+      }
+      m_edges.clear();
+    }
+
+  public:
+    dot_writer(const t_cdbg& g, ostream& out) :
+      m_g(g), m_out(out), m_node(numeric_limits<uint64_t>::max())
+    {
+      m_out.write("digraph G {\n");
+    }
+
+    void add(const occurrence& o)
+    {
+      if (o.node != m_node) {
+        finish_node();
+        m_node = o.node;
+        m_out.write("  ");
+        m_out.write_uint(m_node);
+        m_out.write(" [label=\"");
+      } else {
+        m_out.write(',');
+      }
+      m_out.write_uint(o.pos);
+      if (o.next != numeric_limits<uint64_t>::max()) {
+        m_edges.emplace_back(o.next);
+      }
+    }
+
+    void finish()
+    {
+      finish_node();
+      m_out.write("}\n");
+      m_out.flush();
+    }
+};
+
+
+// Writes the explicit graph of g to filename_output.dot and
+// filename_output.start_nodes.txt, like impl2expl with print_graph, without
+// building it in memory. Occurrences are collected in a buffer of
+// buffer_size bytes; each full buffer is sorted by (node, pos) and spilled
+// to a temporary run file next to the output, and the runs are merged while
+// writing. Peak memory is the implicit graph plus the buffer.
+template<class t_cdbg>
+bool stream_graph(
+  const t_cdbg& g,
+  const string& filename_output,
+  uint64_t buffer_size)
+{
+  ofstream output(filename_output+".dot");
+  ofstream output_start_nodes(filename_output+".start_nodes.txt");
+  if (!output.is_open() || !output_start_nodes.is_open()) {
+    cerr << "Could not open '" << filename_output << ".dot' or '";
+    cerr << filename_output << ".start_nodes.txt' for writing." << endl;
+    return false;
+  }
+  // At least 64Ki occurrences per run keeps the number of open runs small
+  uint64_t capacity = max(buffer_size/sizeof(occurrence), (uint64_t)1<<16);
+  vector<occurrence> buffer;
+  buffer.reserve(capacity);
+  run_files runs;
+  bool ok = true;
+  auto spill = [&]() {
+    sort(buffer.begin(), buffer.end());
+    string filename = filename_output+".run"+to_string(runs.size());
+    ofstream run(filename, std::ios::binary);
+    run.write((char*)buffer.data(), buffer.size()*sizeof(occurrence));
+    if (!run) {
+      cerr << "Could not write temporary file '" << filename << "'." << endl;
+      ok = false;
+    }
+    runs.add(filename);
+    buffer.clear();
+  };
+  vector<uint64_t> start_nodes = g.for_each_occurrence(
+    [&](uint64_t node, uint64_t pos, uint64_t next) {
+      buffer.push_back({node, pos, next});
+      if (buffer.size() == capacity) {
+        if (ok) {
+          spill();
+        } else {
+          buffer.clear();
+        }
+      }
+    });
+  if (!ok) {
+    return false;
+  }
+  {
+    output_buffer out2(output_start_nodes);
+    for (const auto& node : start_nodes) {
+      out2.write_uint(node);
+      out2.write('\n');
+    }
+  }
+  dot_writer<t_cdbg> writer(g, output);
+  if (runs.empty()) {
+    sort(buffer.begin(), buffer.end());
+    for (const auto& o : buffer) {
+      writer.add(o);
+    }
+  } else {
+    if (!buffer.empty()) {
+      spill();
+      if (!ok) {
+        return false;
+      }
+    }
+    vector<occurrence>().swap(buffer);
+    // k-way merge of the runs
+    uint64_t block_size = max(capacity/runs.size(), (uint64_t)1);
+    vector<run_reader> readers;
+    readers.reserve(runs.size());
+    typedef pair<occurrence, uint64_t> head;
+    priority_queue<head, vector<head>, greater<head>> heads;
+    for (uint64_t r = 0; r < runs.size(); ++r) {
+      readers.emplace_back(runs[r], block_size);
+      occurrence o;
+      if (readers[r].next(o)) {
+        heads.emplace(o, r);
+      }
+    }
+    while (!heads.empty()) {
+      head h = heads.top();
+      heads.pop();
+      writer.add(h.first);
+      occurrence o;
+      if (readers[h.second].next(o)) {
+        heads.emplace(o, h.second);
+      }
+    }
+  }
+  writer.finish();
+  return ok && output && output_start_nodes;
+}
+
+
+}  // cdbg
+
+
+#endif
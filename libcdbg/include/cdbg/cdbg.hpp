@@ -2,44 +2,73 @@
 #define CDBG_HPP
 
 // std
+#include <algorithm>  // min, reverse, sort, unique, upper_bound
+#include <atomic>  // atomic
 #include <fstream>  // ifstream
 #include <iomanip>  // setw
 #include <iostream>  // cerr, endl, istream, ostream
 #include <limits>  // numeric_limits
+#include <memory>  // unique_ptr
+#include <mutex>  // call_once, lock_guard, mutex, once_flag
 #include <stack>
 #include <string>  // string, to_string
 #include <tuple>
-#include <utility>  // move
+#include <utility>  // forward, move, pair
 // sdsl
 #include <sdsl/bit_vector_il.hpp>  // bit_vector_il
+#include <sdsl/bits.hpp>  // bits
 #include <sdsl/config.hpp>  // sdsl::conf, cache_config
 #include <sdsl/construct.hpp>  // construct
 #include <sdsl/int_vector_buffer.hpp>
-#include <sdsl/io.hpp>  // read_member, write_member
+#include <sdsl/io.hpp>  // load_from_cache, read_member, write_member
+#include <sdsl/rrr_vector.hpp>  // rrr_vector
+#include <sdsl/sd_vector.hpp>  // sd_vector
 #include <sdsl/structure_tree.hpp>  // structure_tree
 #include <sdsl/util.hpp>  // sdsl::util
 // local
+#include "coordinate_index.hpp"
+#include "csr_graph.hpp"
+#include "io/compressed_stream.hpp"  // is_compressed, section_reader
+#include "kmer_index.hpp"
+#include "node_table.hpp"
 #include "partial_lcp.hpp"
+#include "small_alphabet_bwt.hpp"
 
 
+using std::atomic;
 using std::cerr;
 using std::endl;
+using std::call_once;
+using std::forward;
 using std::ifstream;
 using std::istream;
+using std::lock_guard;
+using std::min;
 using std::move;
+using std::mutex;
 using std::numeric_limits;
+using std::once_flag;
 using std::ostream;
+using std::pair;
+using std::reverse;
 using std::setw;
+using std::sort;
 using std::stack;
 using std::string;
 using std::to_string;
 using std::tuple;
+using std::unique;
+using std::unique_ptr;
+using std::upper_bound;
 using std::vector;
 using sdsl::bit_vector_il;
 using sdsl::cache_config;
 using sdsl::construct;
 using sdsl::int_vector_buffer;
+using sdsl::load_from_cache;
 using sdsl::read_member;
+using sdsl::rrr_vector;
+using sdsl::sd_vector;
 using sdsl::structure_tree;
 using sdsl::write_member;
 
@@ -60,6 +89,66 @@ struct node
 };
 
 
+// Scratch space of the wavelet tree interval queries (interval_symbols);
+// passing the same buffer to repeated calls avoids allocating sigma sized
+// vectors every time, see cursor
+struct interval_buffer
+{
+  vector<uint8_t> chars;
+  vector<uint64_t> sequences;
+  vector<uint64_t> rank_c_i;
+  vector<uint64_t> rank_c_j;
+
+  void reserve(uint64_t sigma)
+  {
+    if (rank_c_i.size() < sigma) {
+      rank_c_i.resize(sigma);
+      rank_c_j.resize(sigma);
+    }
+  }
+};
+
+
+// length consecutive kmers of a path through one node; the first one starts
+// at offset in the node
+struct path_segment
+{
+  uint64_t node;
+  uint64_t offset;
+  uint64_t length;
+};
+
+
+// Components that load can leave in a sectioned graph file until their
+// first use (see io/implicit_stream.hpp); the BWT, the node table and the
+// node boundaries are always loaded
+enum load_part : uint64_t
+{
+  load_documents = 1,  // document array, document samples and color lists
+  load_locate = 2,  // suffix array samples
+  load_all = 3
+};
+
+
+// A component of a graph in its file
+struct file_section
+{
+  string name;
+  uint64_t offset;
+  uint64_t bytes;
+};
+
+
+// Scratch space of the allocation-free queries (find_path, copy_documents)
+// for one thread. Its vectors only grow, so once they fit the largest query
+// no query allocates.
+struct query_workspace
+{
+  interval_buffer buffer;
+  vector<path_segment> segments;
+};
+
+
 template<
   class t_wt=wt_huff<bit_vector, rank_support_v<>, select_support_mcl<1>,
     select_support_mcl<0>>,
@@ -72,24 +161,10 @@ struct compressed_debruijn_graph
   typedef uint64_t size_type;
 
   private:
-    struct node_c
-    {
-      uint64_t lb;  // lb of prefix kmer
-      uint64_t len;
-      uint64_t size;
-      uint64_t first_lb;  // lb of suffix kmer
-      node_c(
-        uint64_t _lb=0,
-        uint64_t _len=0,
-        uint64_t _size=0,
-        uint64_t _first_lb=0) :
-        lb(_lb), len(_len), size(_size), first_lb(_first_lb) { }
-    };
-
     uint64_t m_k;
     t_wt m_wt_bwt;
     vector<uint64_t> m_carray;
-    vector<node_c> m_nodes;
+    node_table m_nodes;
     uint64_t m_right_max;
     vector<uint64_t> m_stop_nodes;
     t_bv1 m_bv1;
@@ -97,6 +172,520 @@ struct compressed_debruijn_graph
     typename t_bv1::rank_1_type m_bv1_rank;
     typename t_bv3::rank_1_type m_bv3_rank;
     t_wt_doc m_wt_doc;
+    uint64_t m_sa_rate;  // 0 if the suffix array is not sampled
+    int_vector<> m_sa_samples;  // SA[i]/m_sa_rate of the sampled i
+    bit_vector m_sa_sampled;  // i is sampled iff SA[i] % m_sa_rate == 0
+    rank_support_v<> m_sa_sampled_rank;
+    int_vector<> m_isa_samples;  // ISA[j*m_sa_rate]
+    int_vector<> m_seq_starts;  // text position of every sequence
+    bit_vector m_prefix_starts;  // lb of every node; empty without successor index
+    rank_support_v<> m_prefix_starts_rank;
+    int_vector<> m_prefix_nodes;  // node of every set bit of m_prefix_starts
+    uint64_t m_checkpoint_rate;  // 0 without node checkpoints
+    bit_vector m_checkpoints;  // suffix array position of every checkpoint
+    rank_support_v<> m_checkpoints_rank;
+    int_vector<> m_checkpoint_nodes;
+    int_vector<> m_checkpoint_steps;  // ilf steps to the end of the node
+    uint64_t m_doc_rate;  // 0 without document samples
+    sd_vector<> m_doc_sampled;  // i is sampled iff its offset in its sequence % m_doc_rate == 0
+    sd_vector<>::rank_1_type m_doc_sampled_rank;
+    int_vector<> m_doc_samples;  // DA[i] of the sampled i
+    bit_vector m_colored;  // nodes with a color list; empty without
+    rank_support_v<> m_colored_rank;
+    int_vector<> m_color_starts;  // of every color list, and the end of the last
+    int_vector<> m_colors;  // sequences of every colored node, sorted
+
+    // Where the parts that load left in the file start
+    struct deferred_parts
+    {
+      string filename;
+      bool compressed = false;  // offsets are in the decompressed bytes
+      uint64_t documents = 0;  // file offset of wt_doc, 0 if loaded
+      uint64_t doc_samples = 0;  // of doc_sampled
+      uint64_t sa_samples = 0;
+      atomic<bool> failed{false};  // a fetch could not load its part
+      once_flag documents_once;
+      once_flag locate_once;
+    };
+    unique_ptr<deferred_parts> m_deferred;  // null if everything is loaded
+
+    static uint8_t bit_width(uint64_t x)
+    {
+      return x ? sdsl::bits::hi(x)+1 : 1;
+    }
+
+    // Number of the node whose suffix kmer interval contains i
+    uint64_t node_number(uint64_t i) const
+    {
+      uint64_t ones = m_bv1_rank(i+1);
+      if (ones % 2 == 0 && m_bv1[i] == 0) {
+        return m_right_max + m_bv3_rank(i);
+      }
+      return (ones-1)/2;
+    }
+
+    // Node whose prefix kmer interval contains i, or undef if there is
+    // none; needs the successor index
+    uint64_t prefix_node(uint64_t i) const
+    {
+      const uint64_t undef = numeric_limits<uint64_t>::max();
+      uint64_t r = m_prefix_starts_rank(i+1);
+      if (r == 0) {
+        return undef;
+      }
+      uint64_t v = m_prefix_nodes[r-1];
+      return (i < m_nodes.lb(v)+m_nodes.interval_size(v)) ? v : undef;
+    }
+
+    // First character of the suffix at position i, i.e. F[i]
+    uint8_t first_char(uint64_t i) const
+    {
+      return upper_bound(m_carray.begin(), m_carray.end(), i) - m_carray.begin() - 1;
+    }
+
+    // Steps forward (ilf) from the suffix array interval [i..j] of a kmer to
+    // the end of its node and returns the node; l is set to the number of
+    // steps (less k-1 if the walk ran into a sentinel). kmer points to the
+    // characters of the kmer, or is nullptr if they are unknown. A checkpoint
+    // (see build_node_checkpoints) ends the walk early. visit(i) is called
+    // for every interval that is stepped over.
+    template<class t_visit>
+    uint64_t end_node(
+      uint64_t i,
+      uint64_t j,
+      const char* kmer,
+      uint64_t& l,
+      t_visit visit) const
+    {
+      uint64_t nodeid = m_wt_bwt.size()+1;
+      l = 0;
+      while (nodeid > m_wt_bwt.size()) {
+        uint64_t ones = m_bv1_rank(i+1);
+        if (ones % 2 == 1 || m_bv1[i] == 1) {
+          nodeid = (ones-1)/2;
+        } else {
+          uint64_t ones_i = m_bv3_rank(i);
+          uint64_t ones_j = m_bv3_rank(j+1);
+          if (ones_i != ones_j) {
+            nodeid = m_right_max + ones_i;
+          } else if (m_checkpoint_rate > 0 && m_checkpoints[i]) {
+            uint64_t checkpoint = m_checkpoints_rank(i);
+            nodeid = m_checkpoint_nodes[checkpoint];
+            l += m_checkpoint_steps[checkpoint];
+          } else {
+            visit(i);
+            uint8_t c = (kmer != nullptr && l < m_k) ? kmer[l] : first_char(i);
+            if (i == j) {
+              i = m_wt_bwt.select(i-m_carray[c]+1, c); // ilf
+              j = i;
+            } else {
+              i = m_wt_bwt.select(i-m_carray[c]+1, c); // ilf
+              j = m_wt_bwt.select(j-m_carray[c]+1, c); // ilf
+            }
+            ++l;
+            if (i < m_carray[2]) {  // Found sentinal
+              nodeid = m_right_max-m_carray[2]+i;
+              l -= (m_k-1);
+            }
+          }
+        }
+      }
+      return nodeid;
+    }
+
+    // Walks one sequence from right to left, starting at the stop node with
+    // suffix array position i (i < m_carray[2]) and the 1-indexed position pos
+    // just after the sequence, and calls visit(node_number, pos,
+    // next_node_number) for every node occurrence; next_node_number is undef
+    // for the stop node. Returns the start node of the sequence; afterwards i
+    // is the stop node position of the preceding sequence and pos the start
+    // position of the walked one.
+    template<class t_visit>
+    uint64_t walk_sequence(uint64_t& i, uint64_t& pos, t_visit visit) const
+    {
+      const uint64_t undef = numeric_limits<uint64_t>::max();
+      uint64_t stop_node_number = m_right_max-m_carray[2]+i;
+      pos -= m_nodes.len(stop_node_number);
+      visit(stop_node_number, pos, undef);
+      return walk_back(stop_node_number, m_nodes.lb(stop_node_number), i, pos,
+        [&](uint64_t node_number, uint64_t p, uint64_t next_node_number, uint64_t) {
+          visit(node_number, p, next_node_number);
+          return true;
+        });
+    }
+
+    // Continues a right to left walk from the occurrence of node
+    // prev_node_number at pos whose prefix kmer has suffix array position
+    // idx: calls visit(node_number, pos, next_node_number, idx) for the
+    // preceding occurrences until the start of the sequence or until visit
+    // returns false. Returns the last visited node; afterwards i is the
+    // suffix array position one before it (the preceding stop node position
+    // at the start of the sequence) and pos the position of the last visited
+    // occurrence.
+    template<class t_visit>
+    uint64_t walk_back(
+      uint64_t prev_node_number,
+      uint64_t idx,
+      uint64_t& i,
+      uint64_t& pos,
+      t_visit visit) const
+    {
+      auto res = m_wt_bwt.inverse_select(idx);
+      i = m_carray[res.second] + res.first;
+      while (res.second > 1) {  // c != sentinal
+        uint64_t node_number = this->node_number(i);
+        idx = m_nodes.lb(node_number) + (i-m_nodes.first_lb(node_number));
+        pos -= (m_nodes.len(node_number)-m_k+1);
+        if (!visit(node_number, pos, prev_node_number, idx)) {
+          return node_number;
+        }
+        // Go Node back
+        prev_node_number = node_number;
+        res = m_wt_bwt.inverse_select(idx);
+        i = m_carray[res.second] + res.first;
+      }
+      return prev_node_number;
+    }
+
+    // Walks all sequences one after another, starting with the last one.
+    // Returns the start node of each sequence.
+    template<class t_visit>
+    vector<uint64_t> walk_sequences(t_visit visit) const
+    {
+      uint64_t d = m_carray[2];
+      vector<uint64_t> start_nodes(d);
+      uint64_t pos = m_wt_bwt.size()+1; // 1 indexed
+      for (uint64_t s = 0, i = 0; s < d; ++s) {
+        start_nodes[d-1-s] = walk_sequence(i, pos, visit);
+      }
+      return start_nodes;
+    }
+
+    // The walks of different sequences are independent once each stop node
+    // knows the position after its sequence: end_pos[i] for stop node i, whose
+    // sequence is the seq[i]-th in the text. With a sampled suffix array these
+    // are the suffix array values of the sentinels. Otherwise a first
+    // parallel pass walks the sequence behind every stop node completely to
+    // get its length and the stop node of the preceding sequence, which
+    // doubles the work of the walks that follow; chaining these from stop
+    // node 0 (the last sequence) yields end_pos.
+    void plan_sequence_walks(
+      uint64_t threads,
+      vector<uint64_t>& end_pos,
+      vector<uint64_t>& seq) const
+    {
+      uint64_t d = m_carray[2];
+      uint64_t n = m_wt_bwt.size()+1;
+      end_pos.resize(d);
+      seq.resize(d);
+      if (m_sa_rate > 0) {
+        fetch(load_locate);
+      }
+      if (m_sa_rate > 0 && m_seq_starts.size() == d) {
+        #pragma omp parallel for num_threads(threads) schedule(dynamic, 1)
+        for (uint64_t s = 0; s < d; ++s) {
+          uint64_t p = sa_value(s);
+          end_pos[s] = p+2;  // 1-indexed, after the sentinel
+          seq[s] = upper_bound(m_seq_starts.begin(), m_seq_starts.end(), p) - m_seq_starts.begin() - 1;
+        }
+        return;
+      }
+      vector<uint64_t> length(d);
+      vector<uint64_t> preceding(d);
+      #pragma omp parallel for num_threads(threads) schedule(dynamic, 1)
+      for (uint64_t s = 0; s < d; ++s) {
+        uint64_t i = s;
+        uint64_t pos = n;
+        walk_sequence(i, pos, [](uint64_t, uint64_t, uint64_t) { });
+        length[s] = n-pos;
+        preceding[s] = i;
+      }
+      for (uint64_t s = 0, i = 0, pos = n; s < d; ++s) {
+        end_pos[i] = pos;
+        seq[i] = d-1-s;
+        pos -= length[i];
+        i = preceding[i];
+      }
+    }
+
+    // Steps back from the sentinel with suffix array position i (i <
+    // m_carray[2]) through the sequence that ends there and calls visit(c)
+    // for its characters from right to left. Returns the position of the
+    // sentinel of the preceding sequence.
+    template<class t_visit>
+    uint64_t walk_text(uint64_t i, t_visit visit) const
+    {
+      auto res = m_wt_bwt.inverse_select(i);
+      while (res.second > 1) {  // c != sentinal
+        visit(res.second);
+        i = m_carray[res.second] + res.first;
+        res = m_wt_bwt.inverse_select(i);
+      }
+      return m_carray[res.second] + res.first;
+    }
+
+    // Samples the suffix array at every text position that is a multiple of
+    // rate, the inverse suffix array at the same positions and the text start
+    // of every sequence, i.e. the position after the preceding sentinel
+    void sample_sa(cache_config& config, uint64_t rate)
+    {
+      int_vector_buffer<> sa(cache_file_name(sdsl::conf::KEY_SA, config));
+      uint64_t n = sa.size();
+      uint64_t d = m_carray[2];
+      m_sa_rate = rate;
+      m_sa_sampled = bit_vector(n, 0);
+      for (uint64_t i = 0; i < n; ++i) {
+        if (sa[i] % rate == 0) {
+          m_sa_sampled[i] = 1;
+        }
+      }
+      m_sa_sampled_rank = rank_support_v<>(&m_sa_sampled);
+      uint64_t samples = (n-1)/rate+1;
+      m_sa_samples = int_vector<>(samples, 0, bit_width(samples-1));
+      m_isa_samples = int_vector<>(samples, 0, bit_width(n-1));
+      vector<uint64_t> ends(d);
+      for (uint64_t i = 0, j = 0; i < n; ++i) {
+        uint64_t value = sa[i];
+        if (i < d) {
+          ends[i] = value;
+        }
+        if (m_sa_sampled[i]) {
+          m_sa_samples[j++] = value/rate;
+          m_isa_samples[value/rate] = i;
+        }
+      }
+      sort(ends.begin(), ends.end());
+      m_seq_starts = int_vector<>(d, 0, bit_width(n-1));
+      for (uint64_t j = 1; j < d; ++j) {
+        m_seq_starts[j] = ends[j-1]+1;
+      }
+    }
+
+    // Text position of the suffix at suffix array position i; at most
+    // m_sa_rate-1 LF steps back to a sampled position
+    uint64_t sa_value(uint64_t i) const
+    {
+      uint64_t steps = 0;
+      while (!m_sa_sampled[i]) {
+        auto res = m_wt_bwt.inverse_select(i);
+        i = m_carray[res.second] + res.first;
+        ++steps;
+      }
+      return m_sa_samples[m_sa_sampled_rank(i)]*m_sa_rate + steps;
+    }
+
+    // Returns read(in) with in over the graph file of the deferred parts,
+    // which a compressed file decompresses section by section; false (with
+    // a message) if the file cannot be opened
+    template<class t_read>
+    bool read_deferred(t_read read) const
+    {
+      const deferred_parts& deferred = *m_deferred;
+      if (deferred.compressed) {
+        io::section_reader buffer(deferred.filename);
+        istream in(&buffer);
+        return buffer.is_open() && read(in);
+      }
+      ifstream in(deferred.filename, std::ios::binary);
+      if (!in.is_open()) {
+        cerr << "Could not open '" << deferred.filename << "' for reading." << endl;
+        return false;
+      }
+      return read(in);
+    }
+
+    // Loads the parts that load left in the file, once, even if several
+    // threads ask at the same time. A part that cannot be loaded is dropped,
+    // as if the graph had been built without it, and load_failed() is set.
+    void fetch(uint64_t parts) const
+    {
+      if (!m_deferred) {
+        return;
+      }
+      auto self = const_cast<compressed_debruijn_graph*>(this);
+      deferred_parts& deferred = *m_deferred;
+      if (parts & load_documents) {
+        call_once(deferred.documents_once, [&]() {
+          bool ok = read_deferred([&](istream& in) {
+            if (deferred.documents) {
+              in.seekg(deferred.documents);
+              self->m_wt_doc.load(in);
+            }
+            if (deferred.doc_samples) {
+              in.seekg(deferred.doc_samples);
+              self->load_doc_samples(in);
+            }
+            return (bool)in;
+          });
+          if (!ok) {
+            cerr << "Could not load the documents of '" << deferred.filename << "'." << endl;
+            self->m_wt_doc = t_wt_doc();
+            self->m_doc_rate = 0;
+            deferred.failed = true;
+          }
+        });
+      }
+      if ((parts & load_locate) && deferred.sa_samples) {
+        call_once(deferred.locate_once, [&]() {
+          bool ok = read_deferred([&](istream& in) {
+            in.seekg(deferred.sa_samples);
+            self->load_sa_samples(in);
+            return (bool)in;
+          });
+          if (!ok) {
+            cerr << "Could not load the suffix array samples of '" << deferred.filename << "'." << endl;
+            self->m_sa_rate = 0;
+            deferred.failed = true;
+          }
+        });
+      }
+    }
+
+    void load_sa_samples(istream& in)
+    {
+      m_sa_samples.load(in);
+      m_sa_sampled.load(in);
+      m_sa_sampled_rank.load(in, &m_sa_sampled);
+      m_isa_samples.load(in);
+      m_seq_starts.load(in);
+    }
+
+    // Takes every component of g, which is a copy of a graph or a graph to
+    // move from, and points the rank supports at the taken bit vectors
+    template<class t_graph>
+    void assign(t_graph&& g)
+    {
+      m_k = g.m_k;
+      m_wt_bwt = forward<t_graph>(g).m_wt_bwt;
+      m_carray = forward<t_graph>(g).m_carray;
+      m_nodes = forward<t_graph>(g).m_nodes;
+      m_right_max = g.m_right_max;
+      m_stop_nodes = forward<t_graph>(g).m_stop_nodes;
+      m_bv1 = forward<t_graph>(g).m_bv1;
+      m_bv3 = forward<t_graph>(g).m_bv3;
+      m_bv1_rank.set_vector(&m_bv1);
+      m_bv3_rank.set_vector(&m_bv3);
+      m_wt_doc = forward<t_graph>(g).m_wt_doc;
+      m_sa_rate = g.m_sa_rate;
+      m_sa_samples = forward<t_graph>(g).m_sa_samples;
+      m_sa_sampled = forward<t_graph>(g).m_sa_sampled;
+      m_sa_sampled_rank.set_vector(&m_sa_sampled);
+      m_isa_samples = forward<t_graph>(g).m_isa_samples;
+      m_seq_starts = forward<t_graph>(g).m_seq_starts;
+      m_prefix_starts = forward<t_graph>(g).m_prefix_starts;
+      m_prefix_starts_rank.set_vector(&m_prefix_starts);
+      m_prefix_nodes = forward<t_graph>(g).m_prefix_nodes;
+      m_checkpoint_rate = g.m_checkpoint_rate;
+      m_checkpoints = forward<t_graph>(g).m_checkpoints;
+      m_checkpoints_rank.set_vector(&m_checkpoints);
+      m_checkpoint_nodes = forward<t_graph>(g).m_checkpoint_nodes;
+      m_checkpoint_steps = forward<t_graph>(g).m_checkpoint_steps;
+      m_doc_rate = g.m_doc_rate;
+      m_doc_sampled = forward<t_graph>(g).m_doc_sampled;
+      m_doc_sampled_rank.set_vector(&m_doc_sampled);
+      m_doc_samples = forward<t_graph>(g).m_doc_samples;
+      m_colored = forward<t_graph>(g).m_colored;
+      m_colored_rank.set_vector(&m_colored);
+      m_color_starts = forward<t_graph>(g).m_color_starts;
+      m_colors = forward<t_graph>(g).m_colors;
+    }
+
+    void load_doc_samples(istream& in)
+    {
+      m_doc_sampled.load(in);
+      m_doc_sampled_rank.load(in, &m_doc_sampled);
+      m_doc_samples.load(in);
+      m_colored.load(in);
+      m_colored_rank.load(in, &m_colored);
+      m_color_starts.load(in);
+      m_colors.load(in);
+    }
+
+    // Reads the graph in the order of serialize; skip(part, first, last)
+    // may move in past the components first to last of the given part and
+    // return the offset of first, otherwise 0
+    template<class t_skip>
+    void load_components(istream& in, t_skip skip)
+    {
+      m_deferred.reset();
+      read_member(m_k, in);
+      m_wt_bwt.load(in);
+      load_vpod(m_carray, in);
+      m_nodes.load(in);
+      read_member(m_right_max, in);
+      load_vpod(m_stop_nodes, in);
+      m_bv1.load(in);
+      m_bv3.load(in);
+      m_bv1_rank.load(in, &m_bv1);
+      m_bv3_rank.load(in, &m_bv3);
+      uint64_t documents = skip(load_documents, "wt_doc", "wt_doc");
+      if (!documents) {
+        m_wt_doc.load(in);
+      }
+      // Graphs written before suffix array sampling end here
+      m_sa_rate = 0;
+      if (in.peek() != istream::traits_type::eof()) {
+        read_member(m_sa_rate, in);
+      }
+      uint64_t sa_samples = 0;
+      if (m_sa_rate > 0) {
+        sa_samples = skip(load_locate, "sa_samples", "seq_starts");
+        if (!sa_samples) {
+          load_sa_samples(in);
+        }
+      }
+      // and before the successor index here
+      uint64_t successor_index = 0;
+      if (in.peek() != istream::traits_type::eof()) {
+        read_member(successor_index, in);
+      }
+      if (successor_index) {
+        m_prefix_starts.load(in);
+        m_prefix_starts_rank.load(in, &m_prefix_starts);
+        m_prefix_nodes.load(in);
+      }
+      // and before node checkpoints here
+      m_checkpoint_rate = 0;
+      if (in.peek() != istream::traits_type::eof()) {
+        read_member(m_checkpoint_rate, in);
+      }
+      if (m_checkpoint_rate > 0) {
+        m_checkpoints.load(in);
+        m_checkpoints_rank.load(in, &m_checkpoints);
+        m_checkpoint_nodes.load(in);
+        m_checkpoint_steps.load(in);
+      }
+      // and before document samples here
+      m_doc_rate = 0;
+      if (in.peek() != istream::traits_type::eof()) {
+        read_member(m_doc_rate, in);
+      }
+      uint64_t doc_samples = 0;
+      if (m_doc_rate > 0) {
+        doc_samples = skip(load_documents, "doc_sampled", "colors");
+        if (!doc_samples) {
+          load_doc_samples(in);
+        }
+      }
+      if (documents || sa_samples || doc_samples) {
+        m_deferred.reset(new deferred_parts());
+        m_deferred->documents = documents;
+        m_deferred->sa_samples = sa_samples;
+        m_deferred->doc_samples = doc_samples;
+      }
+    }
+
+    // Sequence of the suffix at suffix array position i; at most
+    // m_doc_rate-1 LF steps back to a sampled position. The start of every
+    // sequence is sampled, so the walk does not leave the sequence.
+    uint64_t sampled_document(uint64_t i) const
+    {
+      while (!m_doc_sampled[i]) {
+        auto res = m_wt_bwt.inverse_select(i);
+        i = m_carray[res.second] + res.first;
+      }
+      return m_doc_samples[m_doc_sampled_rank(i)];
+    }
 
     void create_carray()
     {
@@ -107,7 +696,7 @@ struct compressed_debruijn_graph
       }
     }
 
-    void detect_nodes(cache_config& config)
+    void detect_nodes(cache_config& config, vector<node_c>& nodes)
     {
       // Create int_vector<2> that indicates if the lcp value is smaller, eqal
       // or greater than k
@@ -136,7 +725,7 @@ struct compressed_debruijn_graph
             if (kvalue > lb) {
               bv1[lb] = true;
               bv1[i-1] = true;
-              m_nodes.emplace_back(node_c(lb, m_k, i-lb, lb));
+              nodes.emplace_back(node_c(lb, m_k, i-lb, lb));
             }
             if (last_change > lb) {
               for (uint64_t j = lb; j <= i-1; ++j) {
@@ -157,7 +746,7 @@ struct compressed_debruijn_graph
         if (kvalue > lb) {
           bv1[lb] = true;
           bv1[lcp_k.size()-1] = true;
-          m_nodes.emplace_back(node_c(lb, m_k, lcp_k.size()-lb, lb));
+          nodes.emplace_back(node_c(lb, m_k, lcp_k.size()-lb, lb));
         }
         if (last_change > lb) {
           for (uint64_t j = lb; j <= lcp_k.size()-1; ++j) {
@@ -168,8 +757,8 @@ struct compressed_debruijn_graph
       }
       // Add Endnodes
       for (uint64_t i = 0; i < m_carray[2]; ++i) {
-        m_stop_nodes.emplace_back(m_nodes.size());
-        m_nodes.emplace_back(node_c(i, 1, 1, i));
+        m_stop_nodes.emplace_back(nodes.size());
+        nodes.emplace_back(node_c(i, 1, 1, i));
         bv3[i] = 0;
       }
       open = false;
@@ -191,7 +780,7 @@ struct compressed_debruijn_graph
       sdsl::util::init_support(m_bv3_rank, &m_bv3);
     }
 
-    void complete_nodes()
+    void complete_nodes(vector<node_c>& nodes)
     {
       uint64_t quantity;
       vector<uint8_t> cs(m_wt_bwt.sigma);  // List of characters in the interval
@@ -199,16 +788,16 @@ struct compressed_debruijn_graph
       vector<uint64_t> rank_c_j(m_wt_bwt.sigma);  // Number of occurrence of character in [0 .. j-1]
       stack<uint64_t> order;
       for (uint64_t i = 0, undef = numeric_limits<uint64_t>::max();
-      i < m_nodes.size(); ++i) {
+      i < nodes.size(); ++i) {
         // Determine which node should be completed next
         uint64_t nodeid = i;
         if (i >= m_right_max) {
           nodeid = order.top();
           order.pop();
         }
-        uint64_t cur_lb = m_nodes[nodeid].lb;
-        uint64_t cur_rb = m_nodes[nodeid].lb+m_nodes[nodeid].size-1;
-        uint64_t cur_len = m_nodes[nodeid].len;
+        uint64_t cur_lb = nodes[nodeid].lb;
+        uint64_t cur_rb = nodes[nodeid].lb+nodes[nodeid].size-1;
+        uint64_t cur_len = nodes[nodeid].len;
         bool extend = true;
         while (extend) {
           extend = false;
@@ -231,11 +820,11 @@ struct compressed_debruijn_graph
               node_number = (ones-1)/2;
             }
             if (node_number != undef) {
-              m_nodes[nodeid].lb = cur_lb;
-              m_nodes[nodeid].len = cur_len;
+              nodes[nodeid].lb = cur_lb;
+              nodes[nodeid].len = cur_len;
             } else if (c <= 1) {  // c == sentinal
-              m_nodes[nodeid].lb = cur_lb;
-              m_nodes[nodeid].len = cur_len;
+              nodes[nodeid].lb = cur_lb;
+              nodes[nodeid].len = cur_len;
             } else {
               if (quantity == 1) {
                 extend = true;
@@ -245,9 +834,9 @@ struct compressed_debruijn_graph
               } else {
                 uint64_t next_node_id = m_right_max + m_bv3_rank(lb);
                 order.push(next_node_id);
-                m_nodes[next_node_id] = node_c(lb, m_k, rb-lb+1, lb);
-                m_nodes[nodeid].lb = cur_lb;
-                m_nodes[nodeid].len = cur_len;
+                nodes[next_node_id] = node_c(lb, m_k, rb-lb+1, lb);
+                nodes[nodeid].lb = cur_lb;
+                nodes[nodeid].len = cur_len;
               }
             }
           }
@@ -257,67 +846,220 @@ struct compressed_debruijn_graph
 
   public:
 
-    compressed_debruijn_graph() {}
+    compressed_debruijn_graph() : m_sa_rate(0), m_checkpoint_rate(0), m_doc_rate(0) {}
 
+    // With sa_sample_rate > 0 every sa_sample_rate-th suffix array value
+    // (and inverse suffix array value) is kept for locate and
+    // extract_substring; this needs the suffix array in the cache
     compressed_debruijn_graph(
       cache_config& config,
       uint64_t k,
-      bool with_document_array) : m_k(k)
+      bool with_document_array,
+      uint64_t sa_sample_rate=0) : m_k(k), m_sa_rate(0), m_checkpoint_rate(0), m_doc_rate(0)
     {
       // Create WT of the BWT
       construct(m_wt_bwt, cache_file_name(sdsl::conf::KEY_BWT, config));
       // Create C-array (needed for interval_symbols)
       create_carray();
       // Detect and create nodes incl. bit vectors for calculation node numbers
-      detect_nodes(config);
+      vector<node_c> nodes;
+      detect_nodes(config, nodes);
       // Add space for nodes not ending with an right maximal kmer
-      m_right_max = m_nodes.size();
+      m_right_max = nodes.size();
       uint64_t lmax = m_bv3_rank(m_bv3.size());
-      m_nodes.resize(m_right_max + lmax);
+      nodes.resize(m_right_max + lmax);
       // Complete nodes
-      complete_nodes();
+      complete_nodes(nodes);
+      m_nodes = node_table(nodes);
       // Load Document Array
       if (with_document_array) {
         construct(m_wt_doc, cache_file_name("DA", config));
       }
+      if (sa_sample_rate > 0) {
+        sample_sa(config, sa_sample_rate);
+      }
+    }
+
+    // A copy has every part loaded, so the parts that g left in its file
+    // are loaded first
+    compressed_debruijn_graph(const compressed_debruijn_graph& g)
+    {
+      *this = g;
+    }
+
+    compressed_debruijn_graph(compressed_debruijn_graph&& g)
+    {
+      *this = move(g);
+    }
+
+    compressed_debruijn_graph& operator=(const compressed_debruijn_graph& g)
+    {
+      if (this != &g) {
+        g.fetch(load_all);
+        assign(g);
+        m_deferred.reset();
+        if (g.load_failed()) {
+          m_deferred.reset(new deferred_parts());
+          m_deferred->filename = g.m_deferred->filename;
+          m_deferred->compressed = g.m_deferred->compressed;
+          m_deferred->failed = true;
+        }
+      }
+      return *this;
+    }
+
+    compressed_debruijn_graph& operator=(compressed_debruijn_graph&& g)
+    {
+      if (this != &g) {
+        assign(move(g));
+        m_deferred = move(g.m_deferred);
+      }
+      return *this;
     }
 
     tuple<vector<node>, vector<uint64_t>> get_explicit_representation() const
     {
       vector<node> graph(m_nodes.size());
-      uint64_t d = m_carray[2];
-      vector<uint64_t> start_nodes(d);
-      uint64_t pos = m_wt_bwt.size()+1; // 1 indexed
-      for (uint64_t s = 0, i = 0; s < d; ++s) {
-        uint64_t prev_node_number = m_right_max-m_carray[2]+i;
-        uint64_t idx = m_nodes[prev_node_number].lb;
-        pos -= m_nodes[prev_node_number].len;
-        graph[prev_node_number].len = m_nodes[prev_node_number].len;
-        graph[prev_node_number].pos_list.emplace_back(pos);
-        graph[prev_node_number].exit_node = true;
-        auto res = m_wt_bwt.inverse_select(idx);
-        i = m_carray[res.second] + res.first;
-        while (res.second > 1) {  // c != sentinal
-          uint64_t ones = m_bv1_rank(i+1);
-          uint64_t node_number = 0;
-          if (ones % 2 == 0 && m_bv1[i] == 0) {
-            node_number = m_right_max + m_bv3_rank(i);
+      vector<uint64_t> start_nodes = walk_sequences(
+        [&](uint64_t node_number, uint64_t pos, uint64_t next_node_number) {
+          // Store all information in new graph
+          if (next_node_number == numeric_limits<uint64_t>::max()) {
+            graph[node_number].exit_node = true;
           } else {
-            node_number = (ones-1)/2;
+            graph[node_number].adj_list.emplace_back(next_node_number);
           }
-          idx = m_nodes[node_number].lb + (i-m_nodes[node_number].first_lb);
-          pos -= (m_nodes[node_number].len-m_k+1);
-          // Store all information in new graph
-          graph[node_number].adj_list.emplace_back(prev_node_number);
           graph[node_number].pos_list.emplace_back(pos);
-          graph[node_number].len = m_nodes[node_number].len;
-          // Go Node back
-          prev_node_number = node_number;
-          res = m_wt_bwt.inverse_select(idx);
-          i = m_carray[res.second] + res.first;
+          graph[node_number].len = m_nodes.len(node_number);
+        });
+      return make_tuple(move(graph), move(start_nodes));
+    }
+
+    // Same graph as get_explicit_representation, but in compressed sparse row
+    // form. Every occurrence of a node is one of its size suffixes, so the
+    // count pass is a prefix sum over the node table and only the fill pass
+    // walks the sequences. With threads > 1 the sequences are split into
+    // threads groups of consecutive sequences of about the same total length
+    // (see plan_sequence_walks), which first count their occurrences of every
+    // node. The prefix sums give every group a slot range in each node, after
+    // those of the groups further right in the text, so walking the groups in
+    // parallel yields the order of the sequential walk without a sort, at the
+    // cost of a second walk and a counter per group and node. Both fill the
+    // bit-packed adj and pos arrays directly; 64 entries of such an array
+    // fill whole words, so only the blocks of 64 entries in which two slot
+    // ranges meet are shared, and only their writes take a lock.
+    tuple<csr_graph, vector<uint64_t>> get_csr_representation(uint64_t threads=1) const
+    {
+      uint64_t n = m_nodes.size();
+      uint64_t d = m_carray[2];
+      uint64_t entries = 0;
+      for (const auto& node : m_nodes) {
+        entries += node.size;
+      }
+      int_vector<> len(n, 0, bit_width(m_wt_bwt.size()));
+      bit_vector exit(n, 0);
+      int_vector<> offsets(n+1, 0, bit_width(entries));
+      for (uint64_t i = 0; i < n; ++i) {
+        len[i] = m_nodes.len(i);
+        offsets[i+1] = offsets[i] + m_nodes.interval_size(i);
+      }
+      for (uint64_t i = 0; i < d; ++i) {
+        exit[m_right_max-d+i] = 1;
+      }
+      vector<uint64_t> start_nodes;
+      int_vector<> adj(entries, 0, bit_width(n));
+      int_vector<> pos(entries, 0, bit_width(m_wt_bwt.size()+1));
+      if (threads <= 1 || d < 2) {
+        int_vector<> next = offsets;
+        start_nodes = walk_sequences(
+          [&](uint64_t node_number, uint64_t p, uint64_t next_node_number) {
+            uint64_t slot = next[node_number];
+            next[node_number] = slot+1;
+            if (next_node_number != numeric_limits<uint64_t>::max()) {
+              adj[slot] = next_node_number;
+            }
+            pos[slot] = p;
+          });
+      } else {
+        vector<uint64_t> end_pos;
+        vector<uint64_t> seq;
+        plan_sequence_walks(threads, end_pos, seq);
+        start_nodes.resize(d);
+        // Walk of every sequence in text order, and the first sequence of
+        // every group; group g walks its sequences from the last to the first
+        vector<uint64_t> walk_of(d);
+        for (uint64_t s = 0; s < d; ++s) {
+          walk_of[seq[s]] = s;
+        }
+        uint64_t groups = min(threads, d);
+        vector<uint64_t> first(groups+1, d);
+        uint64_t total = end_pos[walk_of[d-1]];
+        for (uint64_t t = 0, g = 0; t < d && g < groups; ++t) {
+          if (end_pos[walk_of[t]] > g*total/groups || d-t == groups-g) {
+            first[g++] = t;
+          }
+        }
+        vector<int_vector<>> next(groups);
+        #pragma omp parallel for num_threads(threads) schedule(dynamic, 1)
+        for (uint64_t g = 0; g < groups; ++g) {
+          next[g] = int_vector<>(n, 0, bit_width(entries));
+          for (uint64_t t = first[g+1]; t > first[g]; --t) {
+            uint64_t i = walk_of[t-1];
+            uint64_t seq_pos = end_pos[i];
+            walk_sequence(i, seq_pos, [&](uint64_t node_number, uint64_t, uint64_t) {
+              next[g][node_number] = next[g][node_number]+1;
+            });
+          }
+        }
+        // Blocks of 64 nodes cover whole words of next, and their slots are
+        // disjoint
+        vector<uint8_t> shared((entries+63)/64, 0);
+        #pragma omp parallel for num_threads(threads) schedule(dynamic, 1)
+        for (uint64_t block = 0; block < (n+63)/64; ++block) {
+          for (uint64_t v = block*64; v < min(n, block*64+64); ++v) {
+            uint64_t slot = offsets[v];
+            for (uint64_t g = groups; g > 0; --g) {
+              uint64_t count = next[g-1][v];
+              next[g-1][v] = slot;
+              if (count > 0 && slot%64 != 0) {
+                #pragma omp atomic write
+                shared[slot/64] = 1;
+              }
+              slot += count;
+              if (count > 0 && slot%64 != 0) {
+                #pragma omp atomic write
+                shared[slot/64] = 1;
+              }
+            }
+          }
+        }
+        vector<mutex> locks(4096);
+        #pragma omp parallel for num_threads(threads) schedule(dynamic, 1)
+        for (uint64_t g = 0; g < groups; ++g) {
+          for (uint64_t t = first[g+1]; t > first[g]; --t) {
+            uint64_t i = walk_of[t-1];
+            uint64_t seq_pos = end_pos[i];
+            start_nodes[t-1] = walk_sequence(i, seq_pos,
+              [&](uint64_t node_number, uint64_t p, uint64_t next_node_number) {
+                uint64_t slot = next[g][node_number];
+                next[g][node_number] = slot+1;
+                auto write = [&]() {
+                  if (next_node_number != numeric_limits<uint64_t>::max()) {
+                    adj[slot] = next_node_number;
+                  }
+                  pos[slot] = p;
+                };
+                if (shared[slot/64]) {
+                  lock_guard<mutex> guard(locks[(slot/64) % locks.size()]);
+                  write();
+                } else {
+                  write();
+                }
+              });
+          }
+          int_vector<>().swap(next[g]);
         }
-        start_nodes[d-1-s] = prev_node_number;
       }
+      csr_graph graph(move(len), move(exit), move(offsets), move(adj), move(pos));
       return make_tuple(move(graph), move(start_nodes));
     }
 
@@ -389,7 +1131,7 @@ struct compressed_debruijn_graph
         out << endl;
       }
       // Print node-to-sequence relation details
-      {
+      if (has_document_array()) {
         uint64_t seq_number = m_wt_doc.sigma;
         // k = node_pair[i][j] means:
         // There are k nodes that contain (at least) sequence i and j
@@ -445,15 +1187,678 @@ struct compressed_debruijn_graph
       return m_stop_nodes;
     }
 
-    // Find all nodes that contains the pattern s
-    tuple<vector<uint64_t>, uint64_t> find_nodes(const string& s) const
+    uint64_t number_of_nodes() const
     {
-      vector<uint64_t> result;
-      assert(s.size() >= m_k);
-      if (s.size() < m_k) {
-        cerr << "Pattern length must at least " << m_k << endl;
-        return make_tuple(result, -1);
+      return m_nodes.size();
+    }
+
+    // Length of the text, i.e. of all sequences with their sentinels
+    uint64_t text_length() const
+    {
+      return m_wt_bwt.size();
+    }
+
+    // Identifies the graph to indexes stored next to it: a hash of k, the
+    // number of nodes, the C array and 64 evenly spaced BWT characters
+    uint64_t graph_id() const
+    {
+      uint64_t id = mix64(m_k) ^ mix64(m_nodes.size() + 0x9e3779b97f4a7c15ULL);
+      for (uint64_t c = 0; c < m_carray.size(); ++c) {
+        id = mix64(id ^ m_carray[c]);
+      }
+      uint64_t n = m_wt_bwt.size();
+      for (uint64_t s = 0; n > 0 && s < 64; ++s) {
+        id = mix64(id ^ m_wt_bwt[s*(n-1)/63]);
+      }
+      return id;
+    }
+
+    uint64_t node_length(const uint64_t nodeid) const
+    {
+      return m_nodes.len(nodeid);
+    }
+
+    // Streams the explicit graph without building it: calls
+    // visit(node_number, pos, next_node_number) for every node occurrence,
+    // sequence by sequence from right to left, where next_node_number is
+    // numeric_limits<uint64_t>::max() for stop nodes. Returns the start nodes.
+    template<class t_visit>
+    vector<uint64_t> for_each_occurrence(t_visit visit) const
+    {
+      return walk_sequences(visit);
+    }
+
+    // Label of node nodeid, spelled from the BWT by stepping forward (ilf, as
+    // in find_nodes) from the suffixes of its prefix kmer, or its first
+    // length characters. Labels of nodes that run into the next sequence end
+    // before the sentinel.
+    string node_sequence(const uint64_t nodeid, uint64_t length=numeric_limits<uint64_t>::max()) const
+    {
+      string label;
+      uint64_t i = m_nodes.lb(nodeid);
+      uint64_t len = (length < m_nodes.len(nodeid)) ? length : m_nodes.len(nodeid);
+      for (uint64_t l = 0; l < len; ++l) {
+        uint8_t c = first_char(i);
+        if (c <= 1) {  // c == sentinal
+          break;
+        }
+        label.push_back(c);
+        if (l+1 < len) {
+          i = m_wt_bwt.select(i-m_carray[c]+1, c); // ilf
+        }
+      }
+      return label;
+    }
+
+    // False if the graph was constructed without a document array
+    bool has_document_array() const
+    {
+      fetch(load_documents);
+      return m_wt_doc.size() == m_wt_bwt.size();
+    }
+
+    // True if for_each_document lists the sequences of a node, from the
+    // document array or from document samples
+    bool has_documents() const
+    {
+      return has_document_array() || m_doc_rate > 0;
+    }
+
+    // Sentinel (suffix array position < m_carray[2]) of every sequence, by
+    // sequence id. Read from the document array if there is one; otherwise
+    // the sequences are stepped through in parallel to chain the sentinels
+    // from the terminator of the last sequence.
+    vector<uint64_t> sequence_sentinels(uint64_t threads=1) const
+    {
+      uint64_t d = m_carray[2];
+      vector<uint64_t> sentinels(d);
+      if (has_document_array()) {
+        for (uint64_t i = 0; i < d; ++i) {
+          sentinels[m_wt_doc[i]] = i;
+        }
+        return sentinels;
+      }
+      vector<uint64_t> preceding(d);
+      #pragma omp parallel for num_threads(threads) schedule(dynamic, 1)
+      for (uint64_t s = 0; s < d; ++s) {
+        preceding[s] = walk_text(s, [](uint8_t) { });
+      }
+      for (uint64_t s = 0, i = 0; s < d; ++s) {
+        sentinels[d-1-s] = i;
+        i = preceding[i];
+      }
+      return sentinels;
+    }
+
+    // The sequence that ends at the given sentinel, spelled by LF-walking
+    // back from it
+    string extract_sequence(const uint64_t sentinel) const
+    {
+      string sequence;
+      walk_text(sentinel, [&](uint8_t c) { sequence.push_back(c); });
+      reverse(sequence.begin(), sequence.end());
+      return sequence;
+    }
+
+    // Calls fn(pred) for every node pred with an edge to node nodeid; the
+    // suffixes of nodeid's prefix kmer are extended by each preceding
+    // character, which gives the suffix kmer interval of the predecessor
+    template<class t_fn>
+    void for_each_predecessor(const uint64_t nodeid, t_fn fn, interval_buffer& buffer) const
+    {
+      uint64_t quantity;
+      buffer.reserve(m_wt_bwt.sigma);
+      if (buffer.chars.size() < m_wt_bwt.sigma) {
+        buffer.chars.resize(m_wt_bwt.sigma);
+      }
+      m_wt_bwt.interval_symbols(
+        m_nodes.lb(nodeid),
+        m_nodes.lb(nodeid)+m_nodes.interval_size(nodeid),
+        quantity,
+        buffer.chars,
+        buffer.rank_c_i,
+        buffer.rank_c_j);
+      for (uint64_t j = 0; j < quantity; ++j) {
+        uint8_t c = buffer.chars[j];
+        if (c > 1) {  // c != sentinal
+          fn(node_number(m_carray[c] + buffer.rank_c_i[j]));
+        }
+      }
+    }
+
+    template<class t_fn>
+    void for_each_predecessor(const uint64_t nodeid, t_fn fn) const
+    {
+      interval_buffer buffer;
+      for_each_predecessor(nodeid, fn, buffer);
+    }
+
+    // Calls fn(pred, sequence) for every occurrence of node nodeid that
+    // follows node pred, i.e. for every use of the edge from pred, with the
+    // sequence of the occurrence. Nothing if the graph has no documents.
+    template<class t_fn>
+    void for_each_predecessor_document(const uint64_t nodeid, t_fn fn) const
+    {
+      if (!has_documents()) {
+        return;
+      }
+      uint64_t lb = m_nodes.lb(nodeid);
+      uint64_t size = m_nodes.interval_size(nodeid);
+      for (uint64_t i = lb; i < lb+size; ++i) {
+        auto res = m_wt_bwt.inverse_select(i);
+        if (res.second > 1) {  // c != sentinal
+          uint64_t sequence = has_document_array() ? m_wt_doc[i] : sampled_document(i);
+          fn(node_number(m_carray[res.second] + res.first), sequence);
+        }
+      }
+    }
+
+    // Number of occurrences of node nodeid in the sequences
+    uint64_t occurrence_count(const uint64_t nodeid) const
+    {
+      return m_nodes.interval_size(nodeid);
+    }
+
+    // Calls fn(sequence) for every sequence that contains node nodeid, from
+    // the document array, or else from the color list of the node or the
+    // document samples (in ascending order; see sample_documents). None if
+    // the graph has neither.
+    template<class t_fn>
+    void for_each_document(const uint64_t nodeid, t_fn fn, interval_buffer& buffer) const
+    {
+      if (!has_document_array()) {
+        if (m_doc_rate == 0) {
+          return;
+        }
+        if (m_colored.size() > 0 && m_colored[nodeid]) {
+          uint64_t r = m_colored_rank(nodeid);
+          for (uint64_t p = m_color_starts[r]; p < m_color_starts[r+1]; ++p) {
+            fn(m_colors[p]);
+          }
+          return;
+        }
+        uint64_t lb = m_nodes.lb(nodeid);
+        uint64_t size = m_nodes.interval_size(nodeid);
+        if (buffer.sequences.size() < size) {
+          buffer.sequences.resize(size);
+        }
+        auto first = buffer.sequences.begin();
+        for (uint64_t i = 0; i < size; ++i) {
+          first[i] = sampled_document(lb+i);
+        }
+        sort(first, first+size);
+        auto last = unique(first, first+size);
+        for (auto it = first; it != last; ++it) {
+          fn(*it);
+        }
+        return;
+      }
+      uint64_t quantity;
+      buffer.reserve(m_wt_doc.sigma);
+      if (buffer.sequences.size() < m_wt_doc.sigma) {
+        buffer.sequences.resize(m_wt_doc.sigma);
+      }
+      m_wt_doc.interval_symbols(
+        m_nodes.lb(nodeid),
+        m_nodes.lb(nodeid)+m_nodes.interval_size(nodeid),
+        quantity,
+        buffer.sequences,
+        buffer.rank_c_i,
+        buffer.rank_c_j);
+      for (uint64_t i = 0; i < quantity; ++i) {
+        fn(buffer.sequences[i]);
+      }
+    }
+
+    template<class t_fn>
+    void for_each_document(const uint64_t nodeid, t_fn fn) const
+    {
+      interval_buffer buffer;
+      for_each_document(nodeid, fn, buffer);
+    }
+
+    // Writes the sequences that contain node nodeid to out, which needs room
+    // for at most occurrence_count(nodeid) of them; returns the end of the
+    // written range
+    template<class t_out>
+    t_out copy_documents(const uint64_t nodeid, t_out out, query_workspace& workspace) const
+    {
+      for_each_document(nodeid, [&](uint64_t sequence) {
+        *out++ = sequence;
+      }, workspace.buffer);
+      return out;
+    }
+
+    // Builds the index for for_each_successor. The prefix kmer intervals of
+    // the nodes are disjoint, so marking the lb of every node maps a suffix
+    // array position to the node whose prefix kmer it starts with. Takes n
+    // bits plus one node number per node.
+    void build_successor_index()
+    {
+      m_prefix_starts = bit_vector(m_wt_bwt.size(), 0);
+      for (uint64_t v = 0; v < m_nodes.size(); ++v) {
+        m_prefix_starts[m_nodes.lb(v)] = 1;
+      }
+      sdsl::util::init_support(m_prefix_starts_rank, &m_prefix_starts);
+      m_prefix_nodes = int_vector<>(m_nodes.size(), 0, bit_width(m_nodes.size()));
+      for (uint64_t v = 0; v < m_nodes.size(); ++v) {
+        m_prefix_nodes[m_prefix_starts_rank(m_nodes.lb(v))] = v;
+      }
+    }
+
+    bool has_successor_index() const
+    {
+      return m_prefix_starts.size() > 0;
+    }
+
+    // Calls fn(succ) for every node succ with an edge from node nodeid. The
+    // suffixes of nodeid's suffix kmer are stepped forward by one character
+    // (psi); all of them that land in the prefix kmer interval of one
+    // successor are skipped at once with a rank, so each successor costs a
+    // select and a rank. Only an edge to a stop node is resolved by up to k-1
+    // further psi steps to its sentinel. Needs the successor index.
+    template<class t_fn>
+    void for_each_successor(const uint64_t nodeid, t_fn fn) const
+    {
+      const uint64_t undef = numeric_limits<uint64_t>::max();
+      uint64_t i = m_nodes.first_lb(nodeid);
+      uint64_t end = i + m_nodes.interval_size(nodeid);
+      uint8_t c = first_char(i);
+      if (c <= 1) {  // stop node
+        return;
+      }
+      while (i < end) {
+        uint64_t p = m_wt_bwt.select(i-m_carray[c]+1, c);  // psi
+        uint64_t succ = prefix_node(p);
+        if (succ != undef) {
+          fn(succ);
+          i = m_carray[c] + m_wt_bwt.rank(m_nodes.lb(succ)+m_nodes.interval_size(succ), c);
+        } else {
+          // The next k-1 characters run into a sentinel
+          for (uint8_t e = first_char(p); e > 1; e = first_char(p)) {
+            p = m_wt_bwt.select(p-m_carray[e]+1, e);
+          }
+          fn(m_right_max-m_carray[2]+p);
+          ++i;
+        }
+      }
+    }
+
+    // Builds checkpoints that bound the end node search of find_nodes, which
+    // otherwise steps through the rest of the node of the pattern's suffix
+    // kmer one character at a time. Every kmer of a node that is a multiple
+    // of rate steps before the node's end is a checkpoint storing the node
+    // and the number of steps, so a search takes less than rate steps. A node
+    // whose walk runs into a sentinel counts its steps as end_node does, less
+    // the k-1 steps into the sentinel. Takes n bits plus two numbers per
+    // checkpoint.
+    void build_node_checkpoints(uint64_t rate)
+    {
+      struct checkpoint
+      {
+        uint64_t idx;
+        uint64_t node;
+        uint64_t steps;
+      };
+      m_checkpoint_rate = 0;
+      vector<checkpoint> checkpoints;
+      uint64_t max_steps = 0;
+      for (uint64_t v = 0; v < m_nodes.size(); ++v) {
+        if (m_nodes.len(v) < m_k+rate) {
+          continue;
+        }
+        // Walk from the first kmer of v to its last one
+        uint64_t first = checkpoints.size();
+        uint64_t steps = m_nodes.len(v)-m_k;
+        uint64_t step = 0;
+        uint64_t lb = m_nodes.lb(v);
+        uint64_t l = 0;
+        uint64_t end = end_node(lb, lb+m_nodes.interval_size(v)-1, nullptr, l,
+          [&](uint64_t i) {
+            if ((steps-step) % rate == 0) {
+              checkpoints.push_back({i, v, steps-step});
+            }
+            ++step;
+          });
+        if (end != v || l != steps) {
+          // The walk ran into a sentinel and returns end with l less the
+          // k-1 steps into it; walk again and store what the walk returns
+          // from each checkpoint
+          checkpoints.resize(first);
+          steps = l;
+          step = 0;
+          end_node(lb, lb+m_nodes.interval_size(v)-1, nullptr, l,
+            [&](uint64_t i) {
+              if (step < steps && (steps-step) % rate == 0) {
+                checkpoints.push_back({i, end, steps-step});
+              }
+              ++step;
+            });
+        }
+        max_steps = (steps > max_steps) ? steps : max_steps;
+      }
+      sort(checkpoints.begin(), checkpoints.end(),
+        [](const checkpoint& a, const checkpoint& b) {
+          return a.idx < b.idx;
+        });
+      m_checkpoints = bit_vector(m_wt_bwt.size(), 0);
+      m_checkpoint_nodes = int_vector<>(checkpoints.size(), 0, bit_width(m_nodes.size()));
+      m_checkpoint_steps = int_vector<>(checkpoints.size(), 0, bit_width(max_steps));
+      for (uint64_t c = 0; c < checkpoints.size(); ++c) {
+        m_checkpoints[checkpoints[c].idx] = 1;
+        m_checkpoint_nodes[c] = checkpoints[c].node;
+        m_checkpoint_steps[c] = checkpoints[c].steps;
+      }
+      sdsl::util::init_support(m_checkpoints_rank, &m_checkpoints);
+      m_checkpoint_rate = rate;
+    }
+
+    // 0 if the graph has no node checkpoints
+    uint64_t node_checkpoint_rate() const
+    {
+      return m_checkpoint_rate;
+    }
+
+    // Replaces the document array by samples: the sequence of every suffix
+    // array position whose offset in its sequence is a multiple of rate is
+    // kept, and for_each_document finds the others in less than rate LF
+    // steps each. Takes about n/rate*(log(d)+2+log(rate)) bits instead of
+    // n*log(d). Nodes that occur at least color_threshold times (0: none)
+    // also get a sorted list of their sequences, so listing the frequent
+    // nodes needs no walks. Needs the suffix array and the document array
+    // in the cache.
+    void sample_documents(cache_config& config, uint64_t rate, uint64_t color_threshold=0)
+    {
+      int_vector_buffer<> sa(cache_file_name(sdsl::conf::KEY_SA, config));
+      int_vector<> da;
+      load_from_cache(da, "DA", config);
+      uint64_t n = sa.size();
+      uint64_t d = m_carray[2];
+      vector<uint64_t> starts(d, 0);
+      {
+        vector<uint64_t> ends(d);
+        for (uint64_t i = 0; i < d; ++i) {
+          ends[i] = sa[i];
+        }
+        sort(ends.begin(), ends.end());
+        for (uint64_t j = 1; j < d; ++j) {
+          starts[j] = ends[j-1]+1;
+        }
+      }
+      bit_vector sampled(n, 0);
+      uint64_t samples = 0;
+      for (uint64_t i = 0; i < n; ++i) {
+        if ((sa[i]-starts[da[i]]) % rate == 0) {
+          sampled[i] = 1;
+          ++samples;
+        }
+      }
+      m_doc_samples = int_vector<>(samples, 0, bit_width(d-1));
+      for (uint64_t i = 0, j = 0; i < n; ++i) {
+        if (sampled[i]) {
+          m_doc_samples[j++] = da[i];
+        }
+      }
+      m_doc_rate = rate;
+      m_doc_sampled = sd_vector<>(sampled);
+      sdsl::util::init_support(m_doc_sampled_rank, &m_doc_sampled);
+      // Color lists of the frequent nodes
+      const uint64_t undef = numeric_limits<uint64_t>::max();
+      m_colored = bit_vector((color_threshold > 0) ? m_nodes.size() : 0, 0);
+      vector<uint64_t> color_starts(1, 0);
+      vector<uint64_t> colors;
+      vector<uint64_t> last_node(d, undef);
+      for (uint64_t v = 0; v < m_colored.size(); ++v) {
+        uint64_t lb = m_nodes.lb(v);
+        uint64_t size = m_nodes.interval_size(v);
+        if (size < color_threshold) {
+          continue;
+        }
+        m_colored[v] = 1;
+        uint64_t first = colors.size();
+        for (uint64_t i = lb; i < lb+size; ++i) {
+          if (last_node[da[i]] != v) {
+            last_node[da[i]] = v;
+            colors.emplace_back(da[i]);
+          }
+        }
+        sort(colors.begin()+first, colors.end());
+        color_starts.emplace_back(colors.size());
+      }
+      sdsl::util::init_support(m_colored_rank, &m_colored);
+      m_color_starts = int_vector<>(color_starts.size(), 0, bit_width(colors.size()));
+      for (uint64_t j = 0; j < color_starts.size(); ++j) {
+        m_color_starts[j] = color_starts[j];
+      }
+      m_colors = int_vector<>(colors.size(), 0, bit_width(d-1));
+      for (uint64_t j = 0; j < colors.size(); ++j) {
+        m_colors[j] = colors[j];
+      }
+      m_wt_doc = t_wt_doc();
+    }
+
+    // 0 if the graph has no document samples
+    uint64_t document_sample_rate() const
+    {
+      return m_doc_rate;
+    }
+
+    // Number of nodes with a color list
+    uint64_t colored_nodes() const
+    {
+      fetch(load_documents);
+      return m_color_starts.size() ? m_color_starts.size()-1 : 0;
+    }
+
+    // Checkpoints of the walk over every sequence, about one per rate text
+    // positions, for region_nodes. The sequences are walked in parallel.
+    coordinate_index get_coordinate_index(uint64_t rate, uint64_t threads=1) const
+    {
+      struct checkpoint
+      {
+        uint64_t pos;
+        uint64_t node;
+        uint64_t idx;
+      };
+      uint64_t d = m_carray[2];
+      uint64_t n = m_wt_bwt.size();
+      vector<uint64_t> end_pos;
+      vector<uint64_t> seq;
+      plan_sequence_walks(threads, end_pos, seq);
+      vector<vector<checkpoint>> checkpoints(d);
+      vector<uint64_t> start_pos(d);
+      vector<uint64_t> walk_of(d);  // walk of each sequence, in text order
+      #pragma omp parallel for num_threads(threads) schedule(dynamic, 1)
+      for (uint64_t s = 0; s < d; ++s) {
+        vector<checkpoint>& cps = checkpoints[s];
+        uint64_t stop_node_number = m_right_max-d+s;
+        uint64_t pos = end_pos[s]-m_nodes.len(stop_node_number);
+        cps.push_back({pos, stop_node_number, m_nodes.lb(stop_node_number)});
+        uint64_t block = (pos-1)/rate;
+        uint64_t i;
+        walk_back(stop_node_number, m_nodes.lb(stop_node_number), i, pos,
+          [&](uint64_t node_number, uint64_t p, uint64_t, uint64_t idx) {
+            if ((p-1)/rate < block) {
+              block = (p-1)/rate;
+              cps.push_back({p, node_number, idx});
+            }
+            return true;
+          });
+        start_pos[s] = pos;
+        walk_of[seq[s]] = s;
+      }
+      uint64_t total = 0;
+      for (const auto& cps : checkpoints) {
+        total += cps.size();
+      }
+      int_vector<> seq_starts(d+1, n+1, bit_width(n+1));
+      int_vector<> pos(total, 0, bit_width(n));
+      int_vector<> node(total, 0, bit_width(m_nodes.size()));
+      int_vector<> idx(total, 0, bit_width(n));
+      for (uint64_t t = 0, c = 0; t < d; ++t) {
+        seq_starts[t] = start_pos[walk_of[t]];
+        vector<checkpoint>& cps = checkpoints[walk_of[t]];
+        for (uint64_t j = cps.size(); j > 0; --j, ++c) {
+          pos[c] = cps[j-1].pos;
+          node[c] = cps[j-1].node;
+          idx[c] = cps[j-1].idx;
+        }
+        vector<checkpoint>().swap(cps);
+      }
+      return coordinate_index(rate, graph_id(), move(seq_starts), move(pos), move(node), move(idx));
+    }
+
+    // Nodes covering offsets [begin, end) of sequence seq (0-indexed, in
+    // text order) as (node, offset of the node occurrence in seq), from left
+    // to right. Walks back from the nearest checkpoint of index, so it takes
+    // O(log n + rate + region nodes) steps.
+    vector<pair<uint64_t, uint64_t>> region_nodes(
+      const coordinate_index& index,
+      uint64_t seq,
+      uint64_t begin,
+      uint64_t end) const
+    {
+      vector<pair<uint64_t, uint64_t>> result;
+      if (seq >= index.sequences() || begin >= end) {
+        return result;
+      }
+      uint64_t start = index.sequence_start(seq);
+      uint64_t b = start+begin;
+      uint64_t e = start+end;
+      auto add = [&](uint64_t node_number, uint64_t p) {
+        if (p+m_nodes.len(node_number) <= b) {
+          return false;
+        }
+        if (p < e) {
+          result.emplace_back(node_number, p-start);
+        }
+        return true;
+      };
+      uint64_t c = index.checkpoint(seq, e);
+      uint64_t pos = index.position(c);
+      if (add(index.node(c), pos)) {
+        uint64_t i;
+        walk_back(index.node(c), index.sa_position(c), i, pos,
+          [&](uint64_t node_number, uint64_t p, uint64_t, uint64_t) {
+            return add(node_number, p);
+          });
+      }
+      reverse(result.begin(), result.end());
+      return result;
+    }
+
+    // Index of every kmer to its node and offset, the same as find_nodes
+    // gives for the kmer, with fingerprints of fingerprint_bits bits. The
+    // labels of blocks of nodes are spelled in parallel.
+    kmer_index get_kmer_index(uint64_t fingerprint_bits, uint64_t threads=1) const
+    {
+      const uint64_t block_size = 1ULL << 14;
+      vector<kmer_key> keys;
+      vector<uint64_t> node_starts(1, 0);
+      vector<vector<kmer_key>> block(block_size);
+      for (uint64_t first = 0; first < m_nodes.size(); first += block_size) {
+        uint64_t last = (first+block_size < m_nodes.size()) ? first+block_size : m_nodes.size();
+        #pragma omp parallel for num_threads(threads) schedule(dynamic, 64)
+        for (uint64_t v = first; v < last; ++v) {
+          vector<kmer_key>& node_keys = block[v-first];
+          node_keys.clear();
+          string label = node_sequence(v);
+          for (uint64_t o = 0; o+m_k <= label.size(); ++o) {
+            node_keys.push_back(hash_kmer(label.data()+o, m_k));
+          }
+        }
+        for (uint64_t v = first; v < last; ++v) {
+          keys.insert(keys.end(), block[v-first].begin(), block[v-first].end());
+          node_starts.push_back(keys.size());
+        }
+      }
+      return kmer_index(m_k, graph_id(), keys, node_starts, fingerprint_bits, threads);
+    }
+
+    // Whether a part that load left in the file (see load_part) could not be
+    // loaded on first use (after a message); the queries that needed it
+    // returned incomplete results
+    bool load_failed() const
+    {
+      return m_deferred && m_deferred->failed;
+    }
+
+    // Sampling rate of the suffix array; 0 if locate is not supported
+    uint64_t sa_sample_rate() const
+    {
+      return m_sa_rate;
+    }
+
+    // All occurrences of pattern s as (sequence id, 0-indexed offset in the
+    // sequence), in suffix array order. Needs a sampled suffix array; each
+    // occurrence takes less than sa_sample_rate() LF steps.
+    vector<pair<uint64_t, uint64_t>> locate(const string& s) const
+    {
+      fetch(load_locate);
+      vector<pair<uint64_t, uint64_t>> result;
+      if (m_sa_rate == 0) {
+        cerr << "Graph was built without a sampled suffix array" << endl;
+        return result;
+      }
+      uint64_t i = 0;
+      uint64_t j = m_wt_bwt.size();
+      for (uint64_t pos = s.size(); pos > 0 && i < j; --pos) {
+        uint8_t c = s[pos-1];
+        i = m_carray[c] + m_wt_bwt.rank(i, c);
+        j = m_carray[c] + m_wt_bwt.rank(j, c);
+      }
+      for (; i < j; ++i) {
+        uint64_t value = sa_value(i);
+        uint64_t seq = upper_bound(m_seq_starts.begin(), m_seq_starts.end(), value) - m_seq_starts.begin() - 1;
+        result.emplace_back(seq, value-m_seq_starts[seq]);
+      }
+      return result;
+    }
+
+    // length characters of sequence seq starting at offset (fewer at the end
+    // of the sequence). Needs a sampled suffix array; starts at the next
+    // inverse suffix array sample and LF-walks back.
+    string extract_substring(uint64_t seq, uint64_t offset, uint64_t length) const
+    {
+      fetch(load_locate);
+      string result;
+      if (m_sa_rate == 0 || seq >= m_seq_starts.size()) {
+        return result;
+      }
+      uint64_t n = m_wt_bwt.size();
+      uint64_t seq_end = (seq+1 < m_seq_starts.size()) ? m_seq_starts[seq+1]-1 : n-1;
+      uint64_t begin = m_seq_starts[seq]+offset;
+      if (begin >= seq_end || length == 0) {
+        return result;
       }
+      uint64_t end = (length < seq_end-begin) ? begin+length : seq_end;
+      // Suffix array position i of text position p
+      uint64_t sample = (end+m_sa_rate-1)/m_sa_rate;
+      uint64_t p = n-1;
+      uint64_t i = 0;
+      if (sample < m_isa_samples.size()) {
+        p = sample*m_sa_rate;
+        i = m_isa_samples[sample];
+      }
+      while (p > begin) {
+        auto res = m_wt_bwt.inverse_select(i);
+        i = m_carray[res.second] + res.first;
+        --p;
+        if (p < end) {
+          result.push_back(res.second);
+        }
+      }
+      reverse(result.begin(), result.end());
+      return result;
+    }
+
+    // Searches the pattern s (at least k characters) and calls fn(nodeid,
+    // offset) for the kmers of s from right to left with the node of the
+    // kmer and its offset in the node. False if s does not occur; fn may
+    // have been called for a suffix of s then.
+    template<class t_fn>
+    bool for_each_pattern_node(const string& s, t_fn fn) const
+    {
       // Find sa-interval
       uint64_t i = 0;
       uint64_t j = m_wt_bwt.size()-1;
@@ -476,50 +1881,16 @@ struct compressed_debruijn_graph
         }
       }
       if (i > j) {
-        return make_tuple(result, -1);
+        return false;
       }
       uint64_t lb = i;
       uint64_t rb = j;
       // Find nodeid of end node (node that contains the suffix of length k)
-      uint64_t nodeid = m_wt_bwt.size()+1;
       uint64_t l = 0;
-      while (nodeid > m_wt_bwt.size()) {
-        uint64_t ones = m_bv1_rank(i+1);
-        if (ones % 2 == 1 || m_bv1[i] == 1) {
-          nodeid = (ones-1)/2;
-        } else {
-          uint64_t ones_i = m_bv3_rank(i);
-          uint64_t ones_j = m_bv3_rank(j+1);
-          if (ones_i != ones_j) {
-            nodeid = m_right_max + ones_i;
-          } else {
-            uint8_t c = 0;
-            if (l < m_k) {
-              c = s[s.size()-m_k+l];
-            } else {
-              while (i >= m_carray[c]) {
-                ++c;
-              }
-              --c;
-            }
-            if (i == j) {
-              i = m_wt_bwt.select(i-m_carray[c]+1, c); // ilf
-              j = i;
-            } else {
-              i = m_wt_bwt.select(i-m_carray[c]+1, c); // ilf
-              j = m_wt_bwt.select(j-m_carray[c]+1, c); // ilf
-            }
-            ++l;
-            if (i < m_carray[2]) {  // Found sentinal
-              nodeid = m_right_max-m_carray[2]+i;
-              l -= (m_k-1);
-            }
-          }
-        }
-      }
-      l = m_nodes[nodeid].len - l - m_k;  // Start position of suffix in current node
+      uint64_t nodeid = end_node(i, j, s.data()+s.size()-m_k, l, [](uint64_t) { });
+      l = m_nodes.len(nodeid) - l - m_k;  // Start position of suffix in current node
       // Add nodeid to path
-      result.emplace_back(nodeid);
+      fn(nodeid, l);
       // Find preceeding nodes
       i = lb;
       j = rb;
@@ -530,6 +1901,9 @@ struct compressed_debruijn_graph
         i = m_carray[c] + m_wt_bwt.rank(i  , c);
         j = m_carray[c] + m_wt_bwt.rank(j+1, c)-1; // if i == j this can be done better with inverse_select!
         // auto res = m_wt_bwt.inverse_select(i);
+        if (i > j) {
+          return false;
+        }
         // Check if I'm in a new node
         if (l == 0) {
           uint64_t ones = m_bv1_rank(i+1);
@@ -538,36 +1912,78 @@ struct compressed_debruijn_graph
           } else {
             nodeid = m_right_max + m_bv3_rank(i);
           }
-          l = m_nodes[nodeid].len - m_k;
+          l = m_nodes.len(nodeid) - m_k;
         } else {
           --l;
         }
         // Add nodeid to path
-        result.emplace_back(nodeid);
+        fn(nodeid, l);
+      }
+      return true;
+    }
+
+    // Find all nodes that contains the pattern s
+    tuple<vector<uint64_t>, uint64_t> find_nodes(const string& s) const
+    {
+      vector<uint64_t> result;
+      assert(s.size() >= m_k);
+      if (s.size() < m_k) {
+        cerr << "Pattern length must at least " << m_k << endl;
+        return make_tuple(result, -1);
       }
+      uint64_t l = -1;
+      bool found = for_each_pattern_node(s, [&](uint64_t nodeid, uint64_t offset) {
+        result.emplace_back(nodeid);
+        l = offset;
+      });
       // If pattern was not found
-      if (i>j) {
+      if (!found) {
+        l = result.empty() ? -1 : 0;
         result.resize(0);
-        l = 0;
       }
       return make_tuple(move(result), l);
     }
 
+    // Path of the pattern s through the graph as runs of kmers in the same
+    // node: calls fn(segment) for every path_segment from the start of s to
+    // its end. Unlike find_nodes this does not allocate once workspace has
+    // grown to the longest pattern. False if s does not occur or is shorter
+    // than k.
+    template<class t_fn>
+    bool find_path(const string& s, query_workspace& workspace, t_fn fn) const
+    {
+      vector<path_segment>& segments = workspace.segments;
+      segments.clear();
+      if (s.size() < m_k) {
+        return false;
+      }
+      bool found = for_each_pattern_node(s, [&](uint64_t nodeid, uint64_t offset) {
+        if (!segments.empty() && segments.back().node == nodeid &&
+            segments.back().offset == offset+1) {
+          segments.back().offset = offset;
+          ++segments.back().length;
+        } else {
+          segments.push_back({nodeid, offset, 1});
+        }
+      });
+      if (!found) {
+        return false;
+      }
+      for (auto it = segments.rbegin(); it != segments.rend(); ++it) {
+        fn(*it);
+      }
+      return true;
+    }
+
 	// Find all sequences that occur in a node
 	// Precondition: nodeid is valid
     vector<uint64_t> sequences_in_node(const uint64_t nodeid) const
     {
       assert(nodeid < m_nodes.size());
-      auto node = m_nodes[nodeid];
       vector<uint64_t> result;
-      uint64_t quantity;
-      vector<uint64_t> cs(m_wt_doc.sigma);       // List of sequences in the interval
-      vector<uint64_t> rank_c_i(m_wt_doc.sigma); // Number of occurrence of character in [0 .. i-1]
-      vector<uint64_t> rank_c_j(m_wt_doc.sigma); // Number of occurrence of character in [0 .. j-1]
-      m_wt_doc.interval_symbols(node.lb, node.lb+node.size, quantity, cs, rank_c_i, rank_c_j);
-      for (uint64_t i = 0; i < quantity; ++i) {
-        result.emplace_back(cs[i]);
-      }
+      for_each_document(nodeid, [&](uint64_t sequence) {
+        result.emplace_back(sequence);
+      });
       return result;
     }
 
@@ -603,12 +2019,13 @@ struct compressed_debruijn_graph
       structure_tree_node* v=nullptr,
       string name="") const
     {
+      fetch(load_all);
       structure_tree_node* child = structure_tree::add_child(v, name, sdsl::util::class_name(*this));
       size_type written_bytes = 0;
       written_bytes += write_member(m_k, out, child, "k");
       written_bytes += m_wt_bwt.serialize(out, child, "wt_bwt");
       written_bytes += serialize_vector_pod(m_carray, out, child, "c_array");
-      written_bytes += serialize_vector_pod(m_nodes, out, child, "nodes");
+      written_bytes += m_nodes.serialize(out, child, "nodes");
       written_bytes += write_member(m_right_max, out, child, "right_max");
       written_bytes += serialize_vector_pod(m_stop_nodes, out, child, "stop_nodes");
       written_bytes += m_bv1.serialize(out, child, "bv1");
@@ -616,6 +2033,38 @@ struct compressed_debruijn_graph
       written_bytes += m_bv1_rank.serialize(out, child, "bv1_rank");
       written_bytes += m_bv3_rank.serialize(out, child, "bv3_rank");
       written_bytes += m_wt_doc.serialize(out, child, "wt_doc");
+      written_bytes += write_member(m_sa_rate, out, child, "sa_rate");
+      if (m_sa_rate > 0) {
+        written_bytes += m_sa_samples.serialize(out, child, "sa_samples");
+        written_bytes += m_sa_sampled.serialize(out, child, "sa_sampled");
+        written_bytes += m_sa_sampled_rank.serialize(out, child, "sa_sampled_rank");
+        written_bytes += m_isa_samples.serialize(out, child, "isa_samples");
+        written_bytes += m_seq_starts.serialize(out, child, "seq_starts");
+      }
+      uint64_t successor_index = has_successor_index();
+      written_bytes += write_member(successor_index, out, child, "successor_index");
+      if (successor_index) {
+        written_bytes += m_prefix_starts.serialize(out, child, "prefix_starts");
+        written_bytes += m_prefix_starts_rank.serialize(out, child, "prefix_starts_rank");
+        written_bytes += m_prefix_nodes.serialize(out, child, "prefix_nodes");
+      }
+      written_bytes += write_member(m_checkpoint_rate, out, child, "checkpoint_rate");
+      if (m_checkpoint_rate > 0) {
+        written_bytes += m_checkpoints.serialize(out, child, "checkpoints");
+        written_bytes += m_checkpoints_rank.serialize(out, child, "checkpoints_rank");
+        written_bytes += m_checkpoint_nodes.serialize(out, child, "checkpoint_nodes");
+        written_bytes += m_checkpoint_steps.serialize(out, child, "checkpoint_steps");
+      }
+      written_bytes += write_member(m_doc_rate, out, child, "doc_rate");
+      if (m_doc_rate > 0) {
+        written_bytes += m_doc_sampled.serialize(out, child, "doc_sampled");
+        written_bytes += m_doc_sampled_rank.serialize(out, child, "doc_sampled_rank");
+        written_bytes += m_doc_samples.serialize(out, child, "doc_samples");
+        written_bytes += m_colored.serialize(out, child, "colored");
+        written_bytes += m_colored_rank.serialize(out, child, "colored_rank");
+        written_bytes += m_color_starts.serialize(out, child, "color_starts");
+        written_bytes += m_colors.serialize(out, child, "colors");
+      }
       structure_tree::add_size(child, written_bytes);
       return written_bytes;
     }
@@ -623,91 +2072,105 @@ struct compressed_debruijn_graph
     //! Load sampling from disk
     void load(istream& in)
     {
-      read_member(m_k, in);
-      m_wt_bwt.load(in);
-      load_vpod(m_carray, in);
-      load_vpod(m_nodes, in);
-      read_member(m_right_max, in);
-      load_vpod(m_stop_nodes, in);
-      m_bv1.load(in);
-      m_bv3.load(in);
-      m_bv1_rank.load(in, &m_bv1);
-      m_bv3_rank.load(in, &m_bv3);
-      m_wt_doc.load(in);
+      load_components(in, [](uint64_t, const string&, const string&) { return (uint64_t)0; });
+    }
+
+    // Loads the graph from filename, which in is positioned in, but leaves
+    // the parts that are not in eager (see load_part) in the file if
+    // sections tells where they are; they are loaded on first use
+    void load(
+      istream& in,
+      const string& filename,
+      const vector<file_section>& sections,
+      uint64_t eager)
+    {
+      load_components(in, [&](uint64_t part, const string& first, const string& last) {
+        const file_section* a = nullptr;
+        const file_section* b = nullptr;
+        for (const auto& section : sections) {
+          if (section.name == first) {
+            a = &section;
+          }
+          if (section.name == last) {
+            b = &section;
+          }
+        }
+        if ((eager & part) || a == nullptr || b == nullptr) {
+          return (uint64_t)0;
+        }
+        in.seekg(b->offset+b->bytes);
+        return a->offset;
+      });
+      if (m_deferred) {
+        m_deferred->filename = filename;
+        m_deferred->compressed = io::is_compressed(filename);
+      }
     }
 };
 
 
-// WTTYPE
-#ifdef WTBV
-  // bv
-  typedef wt_huff<bit_vector, rank_support_v<>, select_support_mcl<1>, select_support_mcl<0>> WT_TYPE;
-#elif WTBV5
-  // bv5
-  typedef wt_huff<bit_vector, rank_support_v5<>, select_support_mcl<1>, select_support_mcl<0>> WT_TYPE;
-#elif WTIL
-  // bvil
-  typedef wt_huff<bit_vector_il<>, rank_support_il<>, select_support_il<1>, select_support_il<0>> WT_TYPE;
-#elif WTRRR15
-  // rrr15
-  typedef wt_huff<rrr_vector<15>, rrr_vector<15>::rank_1_type, rrr_vector<15>::select_1_type, rrr_vector<15>::select_0_type> WT_TYPE;
-#elif WTRRR63
-  // rrr63
-  typedef wt_huff<rrr_vector<63>, rrr_vector<63>::rank_1_type, rrr_vector<63>::select_1_type, rrr_vector<63>::select_0_type> WT_TYPE;
-#elif WTSD
-  // sd
-  typedef wt_huff<sd_vector<>, sd_vector<>::rank_1_type, sd_vector<>::select_1_type> WT_TYPE;
-#else
-  // bv
-  typedef wt_huff<bit_vector, rank_support_v<>, select_support_mcl<1>, select_support_mcl<0>> WT_TYPE;
-#endif
+// Space/time profiles of the succinct backends. All of them are instantiated
+// in libcdbg; the profile of a graph is recorded in the header of its file
+// (see io/implicit_stream.hpp), so it is chosen per construct and dispatched
+// at runtime.
+enum class profile : uint8_t
+{
+  bv = 0,  // plain bit vectors, fastest
+  sd = 1,  // sparse bv1 and bv3
+  rrr = 2,  // additionally a compressed wavelet tree of the BWT, smallest
+  dna = 3  // BWT of a DNA text as small_alphabet_bwt, fastest LF steps
+};
+const profile profiles[] = {profile::bv, profile::sd, profile::rrr, profile::dna};
 
 
-// BV1
-#ifdef BV1BV
-  // bv
-  typedef bit_vector BV1_TYPE;
-#elif BV1IL
-  // bvil
-  typedef bit_vector_il<> BV1_TYPE;
-#elif BV1RRR15
-  // rrr15
-  typedef rrr_vector<15> BV1_TYPE;
-#elif BV1RRR63
-  // rrr63
-  typedef rrr_vector<63> BV1_TYPE;
-#elif BV1SD
-  // sd
-  typedef sd_vector<> BV1_TYPE;
-#else
-  // bv
-  typedef bit_vector BV1_TYPE;
-#endif
+typedef wt_huff<bit_vector, rank_support_v<>, select_support_mcl<1>, select_support_mcl<0>> wt_bv;
+typedef wt_huff<rrr_vector<15>, rrr_vector<15>::rank_1_type, rrr_vector<15>::select_1_type, rrr_vector<15>::select_0_type> wt_rrr15;
+typedef small_alphabet_bwt<dna_alphabet> wt_dna;
 
+typedef compressed_debruijn_graph<wt_bv, bit_vector, bit_vector_il<>> CDBG_BV;
+typedef compressed_debruijn_graph<wt_bv, sd_vector<>, sd_vector<>> CDBG_SD;
+typedef compressed_debruijn_graph<wt_rrr15, sd_vector<>, sd_vector<>> CDBG_RRR;
+typedef compressed_debruijn_graph<wt_dna, bit_vector, bit_vector_il<>> CDBG_DNA;
 
-// BV3
-#ifdef BV3BV
-  // bv
-  typedef bit_vector BV3_TYPE;
-#elif BV3IL
-  // bvil
-  typedef bit_vector_il<> BV3_TYPE;
-#elif BV3RRR15
-  // rrr15
-  typedef rrr_vector<15> BV3_TYPE;
-#elif BV3RRR63
-  // rrr63
-  typedef rrr_vector<63> BV3_TYPE;
-#elif BV3SD
-  // sd
-  typedef sd_vector<> BV3_TYPE;
-#else
-  // bv
-  typedef bit_vector BV3_TYPE;
-#endif
+// The default profile
+typedef CDBG_BV CDBG;
+
+
+extern template struct compressed_debruijn_graph<wt_bv, bit_vector, bit_vector_il<>>;
+extern template struct compressed_debruijn_graph<wt_bv, sd_vector<>, sd_vector<>>;
+extern template struct compressed_debruijn_graph<wt_rrr15, sd_vector<>, sd_vector<>>;
+extern template struct compressed_debruijn_graph<wt_dna, bit_vector, bit_vector_il<>>;
 
 
-typedef compressed_debruijn_graph<WT_TYPE, BV1_TYPE, BV3_TYPE> CDBG;
+inline profile profile_of(const CDBG_BV&) { return profile::bv; }
+inline profile profile_of(const CDBG_SD&) { return profile::sd; }
+inline profile profile_of(const CDBG_RRR&) { return profile::rrr; }
+inline profile profile_of(const CDBG_DNA&) { return profile::dna; }
+
+
+inline string profile_name(profile p)
+{
+  switch (p) {
+    case profile::bv: return "bv";
+    case profile::sd: return "sd";
+    case profile::rrr: return "rrr";
+    case profile::dna: return "dna";
+  }
+  return "unknown";
+}
+
+
+// False if name is not a profile
+inline bool parse_profile(const string& name, profile& p)
+{
+  for (const auto& candidate : profiles) {
+    if (profile_name(candidate) == name) {
+      p = candidate;
+      return true;
+    }
+  }
+  return false;
+}
 
 
 }  // cdbg
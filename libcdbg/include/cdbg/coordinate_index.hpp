@@ -0,0 +1,170 @@
+#ifndef COORDINATE_INDEX_HPP
+#define COORDINATE_INDEX_HPP
+
+// std
+#include <iostream>  // istream, ostream
+#include <string>
+#include <utility>  // move
+// sdsl
+#include <sdsl/int_vector.hpp>  // int_vector
+#include <sdsl/io.hpp>  // read_member, write_member
+#include <sdsl/structure_tree.hpp>  // structure_tree, structure_tree_node
+
+
+using std::istream;
+using std::move;
+using std::ostream;
+using std::string;
+using sdsl::int_vector;
+using sdsl::read_member;
+using sdsl::structure_tree;
+using sdsl::structure_tree_node;
+using sdsl::write_member;
+
+
+namespace cdbg {
+
+
+// Sampled checkpoints of the walk over every sequence, for region queries
+// (see CDBG::get_coordinate_index and CDBG::region_nodes). Every sequence has
+// a checkpoint at its stop node and one at the first node occurrence (from
+// the right) in every block of rate text positions. A checkpoint is a node
+// occurrence: its 1-indexed text position, the node and the suffix array
+// position of the occurrence's prefix kmer, from which the walk continues.
+// The index records the CDBG::graph_id of its graph.
+class coordinate_index
+{
+  private:
+    uint64_t m_rate;
+    uint64_t m_graph_id;  // see CDBG::graph_id, to recognize another graph
+    int_vector<> m_seq_starts;  // 1-indexed, plus one past the text
+    int_vector<> m_pos;  // ascending
+    int_vector<> m_node;
+    int_vector<> m_idx;
+
+    // First checkpoint with position >= pos
+    uint64_t lower_bound(uint64_t pos) const
+    {
+      uint64_t lo = 0;
+      uint64_t hi = m_pos.size();
+      while (lo < hi) {
+        uint64_t mid = lo + (hi-lo)/2;
+        if (m_pos[mid] < pos) {
+          lo = mid+1;
+        } else {
+          hi = mid;
+        }
+      }
+      return lo;
+    }
+
+  public:
+    typedef uint64_t size_type;
+
+    coordinate_index() : m_rate(0), m_graph_id(0) { }
+
+    coordinate_index(
+      uint64_t rate,
+      uint64_t graph_id,
+      int_vector<>&& seq_starts,
+      int_vector<>&& pos,
+      int_vector<>&& node,
+      int_vector<>&& idx) :
+      m_rate(rate),
+      m_graph_id(graph_id),
+      m_seq_starts(move(seq_starts)),
+      m_pos(move(pos)),
+      m_node(move(node)),
+      m_idx(move(idx)) { }
+
+    uint64_t rate() const
+    {
+      return m_rate;
+    }
+
+    // CDBG::graph_id of the graph the index was built for
+    uint64_t graph_id() const
+    {
+      return m_graph_id;
+    }
+
+    uint64_t sequences() const
+    {
+      return m_seq_starts.empty() ? 0 : m_seq_starts.size()-1;
+    }
+
+    // 1-indexed text position of sequence seq
+    uint64_t sequence_start(uint64_t seq) const
+    {
+      return m_seq_starts[seq];
+    }
+
+    // Length of sequence seq, without its sentinel
+    uint64_t sequence_length(uint64_t seq) const
+    {
+      return m_seq_starts[seq+1]-m_seq_starts[seq]-1;
+    }
+
+    // Checkpoint to walk back from for a region of sequence seq that ends
+    // before the 1-indexed text position end: the first checkpoint of seq
+    // at or after end, or its last one (the stop node)
+    uint64_t checkpoint(uint64_t seq, uint64_t end) const
+    {
+      uint64_t c = lower_bound(end);
+      uint64_t last = lower_bound(m_seq_starts[seq+1])-1;
+      return (c < last) ? c : last;
+    }
+
+    uint64_t checkpoints() const
+    {
+      return m_pos.size();
+    }
+
+    uint64_t position(uint64_t c) const
+    {
+      return m_pos[c];
+    }
+
+    uint64_t node(uint64_t c) const
+    {
+      return m_node[c];
+    }
+
+    uint64_t sa_position(uint64_t c) const
+    {
+      return m_idx[c];
+    }
+
+    size_type serialize(
+      ostream& out,
+      structure_tree_node* v=nullptr,
+      string name="") const
+    {
+      structure_tree_node* child = structure_tree::add_child(v, name, "coordinate_index");
+      size_type written_bytes = 0;
+      written_bytes += write_member(m_rate, out, child, "rate");
+      written_bytes += write_member(m_graph_id, out, child, "graph_id");
+      written_bytes += m_seq_starts.serialize(out, child, "seq_starts");
+      written_bytes += m_pos.serialize(out, child, "pos");
+      written_bytes += m_node.serialize(out, child, "node");
+      written_bytes += m_idx.serialize(out, child, "idx");
+      structure_tree::add_size(child, written_bytes);
+      return written_bytes;
+    }
+
+    void load(istream& in)
+    {
+      read_member(m_rate, in);
+      read_member(m_graph_id, in);
+      m_seq_starts.load(in);
+      m_pos.load(in);
+      m_node.load(in);
+      m_idx.load(in);
+    }
+};
+
+
+}  // cdbg
+
+
+#endif
@@ -0,0 +1,146 @@
+#ifndef CSR_GRAPH_HPP
+#define CSR_GRAPH_HPP
+
+// std
+#include <iterator>  // forward_iterator_tag
+#include <utility>  // move
+// sdsl
+#include <sdsl/int_vector.hpp>  // bit_vector, int_vector
+
+
+using std::forward_iterator_tag;
+using std::move;
+using sdsl::bit_vector;
+using sdsl::int_vector;
+
+
+namespace cdbg {
+
+
+// Read-only view of the adjacency or position list of a single node in a
+// csr_graph; mirrors the parts of vector<uint64_t> used on node lists
+class csr_list
+{
+  private:
+    const int_vector<>* m_values;
+    uint64_t m_begin;
+    uint64_t m_size;
+
+  public:
+    csr_list(const int_vector<>* values=nullptr, uint64_t begin=0, uint64_t size=0) :
+      m_values(values), m_begin(begin), m_size(size) { }
+
+    uint64_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    uint64_t operator[](uint64_t i) const { return (*m_values)[m_begin+i]; }
+    uint64_t front() const { return (*m_values)[m_begin]; }
+    uint64_t back() const { return (*m_values)[m_begin+m_size-1]; }
+};
+
+
+// A node of a csr_graph, with the same members as node
+struct csr_node
+{
+  uint64_t len;
+  bool exit_node;
+  csr_list adj_list;
+  csr_list pos_list;
+  csr_node(uint64_t _len, bool _exit_node, csr_list _adj_list, csr_list _pos_list) :
+    len(_len), exit_node(_exit_node), adj_list(_adj_list), pos_list(_pos_list) { }
+};
+
+
+// Explicit graph in compressed sparse row form: the entries of node i are
+// [offsets[i], offsets[i+1]) in the contiguous position and edge arrays.
+// Edge j belongs to position j; exit nodes have positions but no edges. All
+// arrays are bit-packed.
+class csr_graph
+{
+  private:
+    int_vector<> m_len;
+    bit_vector m_exit;
+    int_vector<> m_offsets;
+    int_vector<> m_adj;
+    int_vector<> m_pos;
+
+  public:
+    class const_iterator
+    {
+      private:
+        const csr_graph* m_graph;
+        uint64_t m_idx;
+
+      public:
+        typedef forward_iterator_tag iterator_category;
+        typedef csr_node value_type;
+        typedef int64_t difference_type;
+        typedef const csr_node* pointer;
+        typedef csr_node reference;
+
+        const_iterator(const csr_graph* graph, uint64_t idx) :
+          m_graph(graph), m_idx(idx) { }
+        csr_node operator*() const { return (*m_graph)[m_idx]; }
+        const_iterator& operator++() { ++m_idx; return *this; }
+        bool operator==(const const_iterator& it) const { return m_idx == it.m_idx; }
+        bool operator!=(const const_iterator& it) const { return m_idx != it.m_idx; }
+    };
+
+    csr_graph() { }
+
+    csr_graph(
+      int_vector<>&& len,
+      bit_vector&& exit,
+      int_vector<>&& offsets,
+      int_vector<>&& adj,
+      int_vector<>&& pos) :
+      m_len(move(len)),
+      m_exit(move(exit)),
+      m_offsets(move(offsets)),
+      m_adj(move(adj)),
+      m_pos(move(pos)) { }
+
+    uint64_t size() const
+    {
+      return m_len.size();
+    }
+
+    // Total number of positions (labels) over all nodes
+    uint64_t entries() const
+    {
+      return m_pos.size();
+    }
+
+    csr_node operator[](uint64_t i) const
+    {
+      uint64_t begin = m_offsets[i];
+      uint64_t size = m_offsets[i+1]-begin;
+      bool exit_node = m_exit[i];
+      return csr_node(
+        m_len[i],
+        exit_node,
+        csr_list(&m_adj, begin, exit_node ? 0 : size),
+        csr_list(&m_pos, begin, size));
+    }
+
+    const_iterator begin() const
+    {
+      return const_iterator(this, 0);
+    }
+
+    const_iterator end() const
+    {
+      return const_iterator(this, size());
+    }
+
+    uint64_t size_in_bytes() const
+    {
+      return (m_len.bit_size() + m_exit.bit_size() + m_offsets.bit_size() +
+              m_adj.bit_size() + m_pos.bit_size() + 7) / 8;
+    }
+};
+
+
+}  // cdbg
+
+
+#endif
@@ -0,0 +1,143 @@
+#ifndef CURSOR_HPP
+#define CURSOR_HPP
+
+// std
+#include <limits>  // numeric_limits
+#include <string>
+#include <vector>
+// local
+#include "cdbg.hpp"  // interval_buffer
+
+
+using std::numeric_limits;
+using std::string;
+using std::vector;
+
+
+namespace cdbg {
+
+
+// On-demand navigation over the implicit graph for one thread: nothing is
+// materialized up front, every call is answered from the succinct structures
+// of the graph. A cursor reuses the scratch space of the wavelet tree queries
+// and keeps the neighbours of recently visited nodes in a direct mapped
+// cache, which traversals that revisit nodes (bubbles, path extension)
+// benefit from. Cursors are cheap; use one per thread, the graph itself is
+// only read. Successors need the successor index of the graph.
+template<class t_cdbg>
+class cursor
+{
+  private:
+    struct cache_entry
+    {
+      uint64_t node = numeric_limits<uint64_t>::max();
+      bool has_successors = false;
+      bool has_predecessors = false;
+      vector<uint64_t> successors;
+      vector<uint64_t> predecessors;
+    };
+
+    const t_cdbg* m_g;
+    interval_buffer m_buffer;
+    vector<cache_entry> m_cache;
+
+    cache_entry& entry(uint64_t nodeid)
+    {
+      cache_entry& e = m_cache[nodeid & (m_cache.size()-1)];
+      if (e.node != nodeid) {
+        e.node = nodeid;
+        e.has_successors = false;
+        e.has_predecessors = false;
+      }
+      return e;
+    }
+
+  public:
+    // cache_size is rounded up to a power of two
+    explicit cursor(const t_cdbg& g, uint64_t cache_size=1024) : m_g(&g)
+    {
+      uint64_t size = 1;
+      while (size < cache_size) {
+        size <<= 1;
+      }
+      m_cache.resize(size);
+    }
+
+    const t_cdbg& graph() const
+    {
+      return *m_g;
+    }
+
+    uint64_t node_length(const uint64_t nodeid) const
+    {
+      return m_g->node_length(nodeid);
+    }
+
+    string node_sequence(const uint64_t nodeid) const
+    {
+      return m_g->node_sequence(nodeid);
+    }
+
+    uint64_t occurrence_count(const uint64_t nodeid) const
+    {
+      return m_g->occurrence_count(nodeid);
+    }
+
+    // The returned neighbours stay valid until the next call on this cursor
+    const vector<uint64_t>& successors(const uint64_t nodeid)
+    {
+      cache_entry& e = entry(nodeid);
+      if (!e.has_successors) {
+        e.successors.clear();
+        m_g->for_each_successor(nodeid, [&](uint64_t succ) {
+          e.successors.emplace_back(succ);
+        });
+        e.has_successors = true;
+      }
+      return e.successors;
+    }
+
+    const vector<uint64_t>& predecessors(const uint64_t nodeid)
+    {
+      cache_entry& e = entry(nodeid);
+      if (!e.has_predecessors) {
+        e.predecessors.clear();
+        m_g->for_each_predecessor(nodeid, [&](uint64_t pred) {
+          e.predecessors.emplace_back(pred);
+        }, m_buffer);
+        e.has_predecessors = true;
+      }
+      return e.predecessors;
+    }
+
+    // fn may use the cursor, e.g. to continue a traversal
+    template<class t_fn>
+    void for_each_successor(const uint64_t nodeid, t_fn fn)
+    {
+      vector<uint64_t> succs = successors(nodeid);
+      for (const auto& succ : succs) {
+        fn(succ);
+      }
+    }
+
+    template<class t_fn>
+    void for_each_predecessor(const uint64_t nodeid, t_fn fn)
+    {
+      vector<uint64_t> preds = predecessors(nodeid);
+      for (const auto& pred : preds) {
+        fn(pred);
+      }
+    }
+
+    template<class t_fn>
+    void for_each_document(const uint64_t nodeid, t_fn fn)
+    {
+      m_g->for_each_document(nodeid, fn, m_buffer);
+    }
+};
+
+
+}  // cdbg
+
+
+#endif
@@ -0,0 +1,193 @@
+#ifndef COMPRESSED_STREAM_HPP
+#define COMPRESSED_STREAM_HPP
+
+
+// std
+#include <fstream>  // ifstream
+#include <streambuf>  // streambuf
+#include <string>
+#include <utility>  // pair
+#include <vector>
+// sdsl
+#include <sdsl/structure_tree.hpp>  // structure_tree_node
+
+
+using std::ifstream;
+using std::pair;
+using std::streambuf;
+using std::string;
+using std::vector;
+using sdsl::structure_tree_node;
+
+
+namespace cdbg {
+namespace io {
+
+
+// Compressed graph file format (all fixed-width fields are little-endian
+// uint64_t): the bytes of an implicit graph file, split into sections (the
+// implicit header and every component that serialize writes) and every
+// section into chunks of at most chunk_bytes that are compressed on their
+// own with zstd:
+//
+//   header    compressed_header
+//   sections  compressed_section per section, in file order
+//   chunks    compressed_chunk per chunk, in file order
+//   data      the compressed chunks
+//
+// Chunks are independent, so they are compressed and decompressed in
+// parallel. Raw offsets are those of the implicit graph file, so its section
+// directory also locates the components in a compressed one.
+
+
+const char compressed_magic[8] = {'C', 'D', 'B', 'G', 'Z', 'S', 'T', '\0'};
+const uint64_t compressed_version = 1;
+const uint64_t default_chunk_bytes = 1ULL << 23;
+
+
+struct compressed_header
+{
+  char magic[8];
+  uint64_t version;
+  uint64_t profile;
+  uint64_t raw_bytes;  // of the implicit graph file
+  uint64_t sections;
+  uint64_t chunks;
+};
+
+
+struct compressed_section
+{
+  char name[32];  // of the component, NUL-terminated
+  uint64_t raw_offset;
+  uint64_t raw_bytes;
+  uint64_t first_chunk;
+  uint64_t chunks;
+};
+
+
+struct compressed_chunk
+{
+  uint64_t raw_bytes;
+  uint64_t offset;  // in the data section
+  uint64_t bytes;
+};
+
+
+// The table of contents of a compressed graph file
+struct compressed_directory
+{
+  compressed_header header;
+  vector<compressed_section> sections;
+  vector<compressed_chunk> chunks;
+};
+
+
+// Whether filename is a compressed graph file
+bool is_compressed(const string& filename);
+
+
+// Reads the table of contents; false (with a message) if filename is not a
+// compressed graph file of this version
+bool read_compressed_directory(const string& filename, compressed_directory& directory);
+
+
+// Compresses raw at level into filename; sections are the names and raw
+// offsets of the sections in ascending order. False (with a message) on
+// failure.
+bool write_compressed(
+  const string& filename,
+  const string& raw,
+  const vector<pair<string, uint64_t>>& sections,
+  uint64_t profile,
+  int level,
+  uint64_t chunk_bytes=default_chunk_bytes,
+  uint64_t threads=0);
+
+
+// Output buffer that counts the bytes written to it and records where each
+// top-level component of the graph that serialize writes below root starts
+class section_recorder : public streambuf
+{
+  private:
+    uint64_t m_bytes;
+    const structure_tree_node& m_root;
+    vector<pair<string, uint64_t>>& m_sections;
+    vector<string> m_seen;
+
+    // Components are added to the structure tree before their bytes
+    void record();
+
+  protected:
+    int_type overflow(int_type c) override;
+    std::streamsize xsputn(const char* s, std::streamsize n) override;
+
+  public:
+    section_recorder(
+      const structure_tree_node& root,
+      vector<pair<string, uint64_t>>& sections);
+
+    uint64_t bytes() const;
+
+    // Components that start at the same offset are seen together; puts the
+    // empty ones first. Call it after serialize.
+    void finish();
+};
+
+
+// Output buffer that appends to a string
+class string_buffer : public streambuf
+{
+  private:
+    string& m_data;
+
+  protected:
+    int_type overflow(int_type c) override;
+    std::streamsize xsputn(const char* s, std::streamsize n) override;
+
+  public:
+    string_buffer(string& data);
+};
+
+
+// Input buffer over the bytes of the implicit graph file in a compressed
+// graph file. It decompresses one section at a time, when it is read or
+// sought, with threads threads (0: one per core) and frees the previous one,
+// so loading holds a single section besides the graph. Reads fail (with a
+// message) if the file is not a compressed graph or a chunk is corrupt.
+class section_reader : public streambuf
+{
+  private:
+    string m_filename;
+    uint64_t m_threads;
+    ifstream m_in;
+    compressed_directory m_directory;
+    uint64_t m_data_offset;  // of the compressed chunks in the file
+    bool m_open;
+    uint64_t m_pos;  // raw offset of the get area
+    string m_raw;  // the decompressed section in the get area
+
+    // Decompresses section s into the get area
+    bool read_section(uint64_t s);
+
+    // Section that contains raw offset; sections.size() past the last
+    uint64_t section_of(uint64_t offset) const;
+
+  protected:
+    int_type underflow() override;
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+
+  public:
+    section_reader(const string& filename, uint64_t threads=0);
+
+    // Whether the table of contents could be read
+    bool is_open() const;
+};
+
+
+}  // io
+}  // cdbg
+
+
+#endif
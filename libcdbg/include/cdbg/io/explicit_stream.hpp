@@ -3,15 +3,18 @@
 
 
 // std
-#include <fstream>  // ifstream, ofstream
+#include <cstring>  // memcpy
+#include <fstream>  // ofstream
 #include <iostream>  // cerr, endl
+#include <iterator>  // forward_iterator_tag
 #include <string>
 #include <vector>
 
 
 using std::cerr;
 using std::endl;
-using std::ifstream;
+using std::forward_iterator_tag;
+using std::memcpy;
 using std::ofstream;
 using std::string;
 using std::vector;
@@ -21,51 +24,361 @@ namespace cdbg {
 namespace io {
 
 
-template<class t_node>
-void store_graph(const vector<t_node>& graph, const string& filename)
+// Explicit graph file format (all fixed-width fields are little-endian
+// uint64_t):
+//
+//   header    explicit_header
+//   offsets   nodes+1 byte offsets of the node records in the data section
+//   data      one record per node:
+//               varint len, varint exit_node, varint #positions,
+//               varint #edges, varint byte size of the encoded positions,
+//               encoded positions, encoded edges
+//
+// Lists are stored back to front, so the descending position lists of
+// get_explicit_representation become ascending, and every value is the
+// zigzag varint of its difference to the previous stored value.
+
+
+const char explicit_magic[8] = {'C', 'D', 'B', 'G', 'E', 'X', 'P', '\0'};
+const uint64_t explicit_version = 1;
+
+
+struct explicit_header
+{
+  char magic[8];
+  uint64_t version;
+  uint64_t nodes;
+  uint64_t entries;  // total number of positions
+  uint64_t data_bytes;
+};
+
+
+inline void put_varint(vector<uint8_t>& out, uint64_t x)
+{
+  while (x >= 0x80) {
+    out.push_back((uint8_t)(x | 0x80));
+    x >>= 7;
+  }
+  out.push_back((uint8_t)x);
+}
+
+
+// Reads no byte at or past end, so a corrupt file cannot make it run off
+// its list
+inline uint64_t get_varint(const uint8_t*& p, const uint8_t* end)
+{
+  uint64_t x = 0;
+  for (uint8_t shift = 0; p < end && shift < 64; shift += 7) {
+    uint8_t byte = *p++;
+    x |= (uint64_t)(byte & 0x7f) << shift;
+    if (byte < 0x80) {
+      return x;
+    }
+  }
+  return x;
+}
+
+
+// Skips count varints; false if they do not all end before end
+inline bool skip_varints(const uint8_t*& p, const uint8_t* end, uint64_t count)
 {
-  ofstream out(filename);
-  uint64_t graph_size = graph.size();
-  out.write((char*)&graph_size, sizeof(graph_size));
+  for (; count > 0; --count) {
+    while (p < end && *p >= 0x80) {
+      ++p;
+    }
+    if (p == end) {
+      return false;
+    }
+    ++p;
+  }
+  return true;
+}
+
+
+inline uint64_t zigzag(uint64_t prev, uint64_t x)
+{
+  int64_t d = (int64_t)(x - prev);
+  return ((uint64_t)d << 1) ^ (uint64_t)(d >> 63);
+}
+
+
+inline uint64_t unzigzag(uint64_t prev, uint64_t z)
+{
+  return prev + ((z >> 1) ^ (~(z & 1) + 1));
+}
+
+
+template<class t_list>
+void put_list(vector<uint8_t>& out, const t_list& list, uint64_t size)
+{
+  uint64_t prev = 0;
+  for (uint64_t i = size; i > 0; --i) {
+    uint64_t value = list[i-1];
+    put_varint(out, zigzag(prev, value));
+    prev = value;
+  }
+}
+
+
+// Zero-copy view of an encoded list in a mapped_graph, which ends before
+// end. Iteration decodes the list back to front, i.e. pos_list in ascending
+// order
+class varint_list
+{
+  private:
+    const uint8_t* m_data;
+    const uint8_t* m_end;
+    uint64_t m_size;
+
+  public:
+    class const_iterator
+    {
+      private:
+        const uint8_t* m_next;
+        const uint8_t* m_end;
+        uint64_t m_left;
+        uint64_t m_value;
+
+        void decode()
+        {
+          if (m_left > 0) {
+            m_value = unzigzag(m_value, get_varint(m_next, m_end));
+          }
+        }
+
+      public:
+        typedef forward_iterator_tag iterator_category;
+        typedef uint64_t value_type;
+        typedef int64_t difference_type;
+        typedef const uint64_t* pointer;
+        typedef uint64_t reference;
+
+        const_iterator(const uint8_t* data, const uint8_t* end, uint64_t left) :
+          m_next(data), m_end(end), m_left(left), m_value(0) { decode(); }
+        uint64_t operator*() const { return m_value; }
+        const_iterator& operator++() { --m_left; decode(); return *this; }
+        bool operator==(const const_iterator& it) const { return m_left == it.m_left; }
+        bool operator!=(const const_iterator& it) const { return m_left != it.m_left; }
+    };
+
+    // Every value takes at least one byte, so size is at most end-data
+    varint_list(const uint8_t* data=nullptr, const uint8_t* end=nullptr, uint64_t size=0) :
+      m_data(data), m_end(end), m_size(size < (uint64_t)(end-data) ? size : end-data) { }
+
+    uint64_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    const_iterator begin() const { return const_iterator(m_data, m_end, m_size); }
+    const_iterator end() const { return const_iterator(nullptr, nullptr, 0); }
+
+    // Decodes the list in its original (front to back) order
+    void decode(vector<uint64_t>& list) const
+    {
+      list.resize(m_size);
+      uint64_t i = m_size;
+      for (const auto& value : *this) {
+        list[--i] = value;
+      }
+    }
+};
+
+
+// A node of a mapped_graph, with the same members as node
+struct mapped_node
+{
+  uint64_t len;
+  bool exit_node;
+  varint_list adj_list;
+  varint_list pos_list;
+};
+
+
+// Read-only explicit graph backed by a memory mapped file; nodes are decoded
+// on access and only the touched pages are read. open checks the offsets of
+// the node records and decoding never leaves a record; valid_node checks the
+// record of a node itself.
+class mapped_graph
+{
+  private:
+    const uint8_t* m_file;
+    uint64_t m_file_size;
+    const explicit_header* m_header;
+    const uint64_t* m_offsets;
+    const uint8_t* m_data;
+
+  public:
+    class const_iterator
+    {
+      private:
+        const mapped_graph* m_graph;
+        uint64_t m_idx;
+
+      public:
+        typedef forward_iterator_tag iterator_category;
+        typedef mapped_node value_type;
+        typedef int64_t difference_type;
+        typedef const mapped_node* pointer;
+        typedef mapped_node reference;
+
+        const_iterator(const mapped_graph* graph, uint64_t idx) :
+          m_graph(graph), m_idx(idx) { }
+        mapped_node operator*() const { return (*m_graph)[m_idx]; }
+        const_iterator& operator++() { ++m_idx; return *this; }
+        bool operator==(const const_iterator& it) const { return m_idx == it.m_idx; }
+        bool operator!=(const const_iterator& it) const { return m_idx != it.m_idx; }
+    };
+
+    mapped_graph();
+    ~mapped_graph();
+    mapped_graph(const mapped_graph&) = delete;
+    mapped_graph& operator=(const mapped_graph&) = delete;
+
+    // With sequential, the kernel reads ahead for a pass over all nodes;
+    // otherwise it expects random access
+    bool open(const string& filename, bool sequential=false);
+    void close();
+
+    bool is_open() const
+    {
+      return m_file != nullptr;
+    }
+
+    uint64_t size() const
+    {
+      return m_header->nodes;
+    }
+
+    uint64_t entries() const
+    {
+      return m_header->entries;
+    }
+
+    mapped_node operator[](uint64_t i) const
+    {
+      const uint8_t* p = m_data + m_offsets[i];
+      const uint8_t* end = m_data + m_offsets[i+1];
+      mapped_node v;
+      v.len = get_varint(p, end);
+      v.exit_node = get_varint(p, end);
+      uint64_t pos_size = get_varint(p, end);
+      uint64_t adj_size = get_varint(p, end);
+      uint64_t pos_bytes = get_varint(p, end);
+      const uint8_t* adj = (pos_bytes < (uint64_t)(end-p)) ? p+pos_bytes : end;
+      v.pos_list = varint_list(p, adj, pos_size);
+      v.adj_list = varint_list(adj, end, adj_size);
+      return v;
+    }
+
+    // Whether the record of node i holds exactly its five fields and lists
+    bool valid_node(uint64_t i) const
+    {
+      const uint8_t* p = m_data + m_offsets[i];
+      const uint8_t* end = m_data + m_offsets[i+1];
+      const uint8_t* fields = p;
+      if (!skip_varints(fields, end, 5)) {
+        return false;
+      }
+      get_varint(p, end);
+      get_varint(p, end);
+      uint64_t pos_size = get_varint(p, end);
+      uint64_t adj_size = get_varint(p, end);
+      uint64_t pos_bytes = get_varint(p, end);
+      if (pos_bytes > (uint64_t)(end-p)) {
+        return false;
+      }
+      const uint8_t* adj = p+pos_bytes;
+      return skip_varints(p, adj, pos_size) && p == adj &&
+             skip_varints(p, end, adj_size) && p == end;
+    }
+
+    const_iterator begin() const
+    {
+      return const_iterator(this, 0);
+    }
+
+    const_iterator end() const
+    {
+      return const_iterator(this, size());
+    }
+};
+
+
+// Works for vector<node> and csr_graph
+template<class t_graph>
+bool store_graph(const t_graph& graph, const string& filename)
+{
+  ofstream out(filename, std::ios::binary);
+  if (!out.is_open()) {
+    cerr << "Could not open '" << filename << "' for writing." << endl;
+    return false;
+  }
+  explicit_header header;
+  memcpy(header.magic, explicit_magic, sizeof(header.magic));
+  header.version = explicit_version;
+  header.nodes = graph.size();
+  header.entries = 0;
+  header.data_bytes = 0;
+  // Placeholders for the header and offsets; both are rewritten at the end
+  vector<uint64_t> offsets(header.nodes+1, 0);
+  out.write((char*)&header, sizeof(header));
+  out.write((char*)offsets.data(), offsets.size()*sizeof(offsets[0]));
+  const uint64_t chunk_size = (uint64_t)1<<22;
+  vector<uint8_t> chunk;
+  vector<uint8_t> pos_bytes;
+  chunk.reserve(chunk_size);
+  uint64_t i = 0;
   for (const auto& node : graph) {
-    uint64_t len = node.len;
-    uint64_t size_adj_list = node.adj_list.size();
-    uint64_t size_pos_list = node.pos_list.size();
-    out.write((char*)&len, sizeof(len));
-    out.write((char*)&size_adj_list, sizeof(size_adj_list));
-    out.write((char*)node.adj_list.data(), size_adj_list*sizeof(node.adj_list[0]));
-    out.write((char*)&size_pos_list, sizeof(size_pos_list));
-    out.write((char*)node.pos_list.data(), size_pos_list*sizeof(node.pos_list[0]));
+    offsets[i++] = header.data_bytes + chunk.size();
+    uint64_t adj_size = node.exit_node ? 0 : node.adj_list.size();
+    pos_bytes.clear();
+    put_list(pos_bytes, node.pos_list, node.pos_list.size());
+    put_varint(chunk, node.len);
+    put_varint(chunk, node.exit_node);
+    put_varint(chunk, node.pos_list.size());
+    put_varint(chunk, adj_size);
+    put_varint(chunk, pos_bytes.size());
+    chunk.insert(chunk.end(), pos_bytes.begin(), pos_bytes.end());
+    put_list(chunk, node.adj_list, adj_size);
+    header.entries += node.pos_list.size();
+    if (chunk.size() >= chunk_size) {
+      out.write((char*)chunk.data(), chunk.size());
+      header.data_bytes += chunk.size();
+      chunk.clear();
+    }
   }
+  out.write((char*)chunk.data(), chunk.size());
+  header.data_bytes += chunk.size();
+  offsets[header.nodes] = header.data_bytes;
+  out.seekp(0);
+  out.write((char*)&header, sizeof(header));
+  out.write((char*)offsets.data(), offsets.size()*sizeof(offsets[0]));
   if (!out) {
     cerr << "Something went wrong - storage didn't work as expected" << endl;
+    return false;
   }
+  return true;
 }
 
 
 template<class t_node>
-void load_graph(vector<t_node>& graph, const string& filename)
+bool load_graph(vector<t_node>& graph, const string& filename)
 {
-  ifstream inp(filename);
-  uint64_t graph_size=0;
-  inp.read((char*)&graph_size, sizeof(graph_size));
-  graph.resize(graph_size);
-  for (uint64_t i = 0; i < graph.size(); ++i) {
-    uint64_t len=0;
-    uint64_t size_adj_list=0;
-    uint64_t size_pos_list=0;
-    inp.read((char*)&len, sizeof(len));
-    graph[i].len = len;
-    inp.read((char*)&size_adj_list, sizeof(size_adj_list));
-    graph[i].adj_list.resize(size_adj_list);
-    inp.read((char*)graph[i].adj_list.data(), size_adj_list*sizeof(graph[i].adj_list[0]));
-    inp.read((char*)&size_pos_list, sizeof(size_pos_list));
-    graph[i].pos_list.resize(size_pos_list);
-    inp.read((char*)graph[i].pos_list.data(), size_pos_list*sizeof(graph[i].pos_list[0]));
+  mapped_graph mapped;
+  if (!mapped.open(filename, true)) {
+    return false;
   }
-  if (!inp) {
-    cerr << "Something went wrong - reading didn't work as expected" << endl;
+  graph.resize(mapped.size());
+  for (uint64_t i = 0; i < graph.size(); ++i) {
+    if (!mapped.valid_node(i)) {
+      cerr << "'" << filename << "' has a corrupt record for node " << i << "." << endl;
+      return false;
+    }
+    mapped_node v = mapped[i];
+    graph[i].len = v.len;
+    graph[i].exit_node = v.exit_node;
+    v.adj_list.decode(graph[i].adj_list);
+    v.pos_list.decode(graph[i].pos_list);
   }
+  return true;
 }
 
 
@@ -3,22 +3,259 @@
 
 
 // std
+#include <cstring>  // memset, strncpy
+#include <fstream>  // ifstream, ofstream
+#include <iostream>  // cerr, endl, istream, ostream
 #include <string>
+#include <utility>  // pair
+#include <vector>
+// sdsl
+#include <sdsl/structure_tree.hpp>  // structure_tree_node
 // local
-#include "cdbg/cdbg.hpp"  // CDBG
+#include "cdbg/cdbg.hpp"  // CDBG, CDBG_BV, CDBG_DNA, CDBG_RRR, CDBG_SD,
+                          // file_section, load_all, profile
+#include "cdbg/io/compressed_stream.hpp"  // is_compressed, section_reader,
+                                          // section_recorder, string_buffer,
+                                          // write_compressed
 
 
+using std::cerr;
+using std::endl;
+using std::ifstream;
+using std::istream;
+using std::memset;
+using std::ofstream;
+using std::ostream;
+using std::pair;
+using std::strncpy;
 using std::string;
+using std::vector;
 using cdbg::CDBG;
+using cdbg::profile;
+using sdsl::structure_tree_node;
 
 
 namespace cdbg {
 namespace io {
 
 
+// Implicit graph file format:
+//
+//   header     implicit_header
+//   sections   uint64_t number of sections, then an implicit_section per
+//              component that serialize writes, in file order
+//   graph      the serialized graph of the recorded profile
+//
+// The section directory lets load leave components in the file until they
+// are used (see load_part). Files of version 1 have no directory; files
+// without the header are rejected. The same bytes may be stored in a
+// compressed graph file (see compressed_stream.hpp), which the loaders
+// recognize by its magic.
+
+
+const char implicit_magic[8] = {'C', 'D', 'B', 'G', 'I', 'M', 'P', '\0'};
+const uint64_t implicit_version = 2;
+
+
+struct implicit_header
+{
+  char magic[8];
+  uint64_t version;
+  uint64_t profile;
+};
+
+
+struct implicit_section
+{
+  char name[32];  // of the component, NUL-terminated
+  uint64_t offset;  // in the file
+  uint64_t bytes;
+};
+
+
+// Reads the header and the section directory, if the file has one, and
+// leaves in at the start of the graph; false (with a message) for a file
+// without the header or an unsupported version or profile
+bool read_implicit_header(
+  istream& in,
+  const string& filename,
+  profile& p,
+  vector<file_section>* sections=nullptr);
+
+
+// Writes the header and the section directory of a graph of profile p
+void write_implicit_header(ostream& out, profile p, const vector<implicit_section>& sections);
+
+
+// Sections of g in its file, from a pass of serialize that only counts the
+// bytes
+template<class t_cdbg>
+vector<implicit_section> implicit_directory(const t_cdbg& g)
+{
+  structure_tree_node root("root", "root");
+  vector<pair<string, uint64_t>> offsets;
+  section_recorder recorder(root, offsets);
+  {
+    ostream out(&recorder);
+    g.serialize(out, &root, "graph");
+  }
+  recorder.finish();
+  uint64_t start = sizeof(implicit_header) + sizeof(uint64_t) +
+                   offsets.size()*sizeof(implicit_section);
+  vector<implicit_section> sections(offsets.size());
+  for (uint64_t s = 0; s < offsets.size(); ++s) {
+    memset(&sections[s], 0, sizeof(implicit_section));
+    strncpy(sections[s].name, offsets[s].first.c_str(), sizeof(sections[s].name)-1);
+    sections[s].offset = start + offsets[s].second;
+    uint64_t end = (s+1 < offsets.size()) ? offsets[s+1].second : recorder.bytes();
+    sections[s].bytes = end - offsets[s].second;
+  }
+  return sections;
+}
+
+
+// Profile of the graph in filename; false (with a message) if it cannot be
+// read
+bool read_profile(const string& filename, profile& p);
+
+
+template<class t_cdbg>
+bool store_implicit(const t_cdbg& g, const string& filename)
+{
+  ofstream out(filename, std::ios::binary);
+  if (!out.is_open()) {
+    cerr << "Could not open '" << filename << "' for writing." << endl;
+    return false;
+  }
+  write_implicit_header(out, profile_of(g), implicit_directory(g));
+  g.serialize(out);
+  if (!out) {
+    cerr << "Something went wrong - storage didn't work as expected" << endl;
+    return false;
+  }
+  return true;
+}
+
+
+// Writes g as a compressed graph file: every component in chunks of at most
+// chunk_bytes, compressed at zstd level with threads threads (0: one per
+// core)
+template<class t_cdbg>
+bool store_compressed(
+  const t_cdbg& g,
+  const string& filename,
+  int level,
+  uint64_t chunk_bytes=default_chunk_bytes,
+  uint64_t threads=0)
+{
+  vector<implicit_section> directory = implicit_directory(g);
+  string raw;
+  {
+    string_buffer buffer(raw);
+    ostream out(&buffer);
+    write_implicit_header(out, profile_of(g), directory);
+    g.serialize(out);
+  }
+  // The header section includes the section directory
+  vector<pair<string, uint64_t>> sections(1, pair<string, uint64_t>("header", 0));
+  for (const auto& section : directory) {
+    sections.emplace_back(section.name, section.offset);
+  }
+  return write_compressed(filename, raw, sections, (uint64_t)profile_of(g), level, chunk_bytes, threads);
+}
+
+
+// Loads a graph of the profile of t_cdbg from in, the contents of filename;
+// with a section directory, only the parts in eager right away
+template<class t_cdbg>
+bool load_implicit(t_cdbg& g, istream& in, const string& filename, uint64_t eager)
+{
+  profile p;
+  vector<file_section> sections;
+  if (!read_implicit_header(in, filename, p, &sections)) {
+    return false;
+  }
+  if (p != profile_of(g)) {
+    cerr << "Graph '" << filename << "' has profile " << profile_name(p);
+    cerr << ", expected " << profile_name(profile_of(g)) << "." << endl;
+    return false;
+  }
+  if (eager == load_all || sections.empty()) {
+    g.load(in);
+  } else {
+    g.load(in, filename, sections, eager);
+  }
+  if (!in) {
+    cerr << "Could not load graph '" << filename << "'; the file is truncated or corrupt." << endl;
+    return false;
+  }
+  return true;
+}
+
+
+// Loads a graph of the profile of t_cdbg from an implicit or a compressed
+// graph file; false (with a message) if the file cannot be read or holds
+// another profile. A compressed file is decompressed one section at a time,
+// its chunks in parallel. Parts that are not in eager are left in the file
+// until their first use; check g.load_failed() after the queries that load
+// them.
+template<class t_cdbg>
+bool load_implicit(t_cdbg& g, const string& filename, uint64_t eager=load_all)
+{
+  if (is_compressed(filename)) {
+    section_reader buffer(filename);
+    if (!buffer.is_open()) {
+      return false;
+    }
+    istream in(&buffer);
+    return load_implicit(g, in, filename, eager);
+  }
+  ifstream in(filename, std::ios::binary);
+  if (!in.is_open()) {
+    cerr << "Could not open '" << filename << "' for reading." << endl;
+    return false;
+  }
+  return load_implicit(g, in, filename, eager);
+}
+
+
+// Graph of the default profile; throws runtime_error (after a message) if
+// it cannot be loaded
 CDBG load_implicit(const string& filename);
 
 
+// Loads the graph in filename with the profile recorded in its header and
+// returns fn(g). fn has to accept every profile, e.g. a functor with a
+// templated call operator. Only the parts in eager are loaded right away;
+// false if fn needed one of the others and it could not be loaded.
+template<class t_fn>
+bool load_implicit(const string& filename, t_fn fn, uint64_t eager=load_all)
+{
+  profile p;
+  if (!read_profile(filename, p)) {
+    return false;
+  }
+  switch (p) {
+    case profile::sd: {
+      CDBG_SD g;
+      return load_implicit(g, filename, eager) && fn(g) && !g.load_failed();
+    }
+    case profile::rrr: {
+      CDBG_RRR g;
+      return load_implicit(g, filename, eager) && fn(g) && !g.load_failed();
+    }
+    case profile::dna: {
+      CDBG_DNA g;
+      return load_implicit(g, filename, eager) && fn(g) && !g.load_failed();
+    }
+    default: {
+      CDBG_BV g;
+      return load_implicit(g, filename, eager) && fn(g) && !g.load_failed();
+    }
+  }
+}
+
+
 }  // io
 }  // cdbg
 
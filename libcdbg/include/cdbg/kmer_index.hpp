@@ -0,0 +1,411 @@
+#ifndef KMER_INDEX_HPP
+#define KMER_INDEX_HPP
+
+// std
+#include <algorithm>  // sort
+#include <cstring>  // memcpy
+#include <iostream>  // istream, ostream
+#include <string>
+#include <utility>  // move
+#include <vector>
+// sdsl
+#include <sdsl/bit_vector_il.hpp>  // bit_vector_il
+#include <sdsl/bits.hpp>  // bits
+#include <sdsl/int_vector.hpp>  // bit_vector, int_vector
+#include <sdsl/io.hpp>  // read_member, write_member
+#include <sdsl/structure_tree.hpp>  // structure_tree, structure_tree_node
+
+
+using std::istream;
+using std::memcpy;
+using std::move;
+using std::ostream;
+using std::sort;
+using std::string;
+using std::vector;
+using sdsl::bit_vector;
+using sdsl::bit_vector_il;
+using sdsl::int_vector;
+using sdsl::read_member;
+using sdsl::structure_tree;
+using sdsl::structure_tree_node;
+using sdsl::write_member;
+
+
+namespace cdbg {
+
+
+// Two independent 64-bit hashes of a kmer
+struct kmer_key
+{
+  uint64_t h1;
+  uint64_t h2;
+};
+
+
+// Finalizer of splitmix64
+inline uint64_t mix64(uint64_t x)
+{
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+
+inline kmer_key hash_kmer(const char* s, uint64_t k)
+{
+  uint64_t h1 = 0x9e3779b97f4a7c15ULL ^ k;
+  uint64_t h2 = 0xc2b2ae3d27d4eb4fULL + k;
+  for (uint64_t i = 0; i < k; i += 8) {
+    uint64_t w = 0;
+    memcpy(&w, s+i, (k-i < 8) ? k-i : 8);
+    h1 = mix64(h1 ^ w);
+    h2 = mix64(h2 + w*0xff51afd7ed558ccdULL);
+  }
+  return {h1, h2};
+}
+
+
+// Kmer to node index (see CDBG::get_kmer_index): a minimal perfect hash
+// function over the kmers of the graph maps every kmer to a slot with its
+// fingerprint, its node and its offset in the node, packed into one integer.
+//
+// The hash function is a cascade of levels (as in BBHash): a level has a bit
+// for about every two kmers that are left; a kmer whose bit no other kmer
+// hits is set there, the others go on to the next level. The slot of a kmer
+// is the rank of its bit over all levels; the few kmers left after the last
+// level are kept in sorted order behind. A lookup is a rank in an interleaved
+// bit vector and an entry, i.e. mostly two cache misses.
+//
+// Every kmer of the graph is found exactly. Any other string of length k also
+// maps to a slot, which is rejected unless the fingerprints match: it is
+// reported as a kmer with probability 2^-fingerprint_bits, so an index
+// should have at least min_kmer_fingerprint_bits.
+const uint64_t min_kmer_fingerprint_bits = 8;
+
+
+class kmer_index
+{
+  private:
+    static const uint64_t max_levels = 24;
+
+    uint64_t m_k;
+    uint64_t m_graph_id;  // see CDBG::graph_id, to recognize another graph
+    uint64_t m_nodes;
+    uint64_t m_fingerprint_bits;
+    uint64_t m_node_bits;
+    uint64_t m_offset_bits;
+    int_vector<64> m_levels;  // first bit of every level, plus the end
+    bit_vector_il<512> m_bits;
+    bit_vector_il<512>::rank_1_type m_bits_rank;
+    int_vector<64> m_fallback;  // h1 and h2 of the kmers in no level, sorted
+    int_vector<> m_entries;  // fingerprint, node, offset of every slot
+    uint64_t m_ones;  // kmers in a level
+
+    static uint8_t width(uint64_t max)
+    {
+      return max ? sdsl::bits::hi(max)+1 : 1;
+    }
+
+    static uint64_t mask(uint64_t bits)
+    {
+      return (bits >= 64) ? ~0ULL : (1ULL << bits)-1;
+    }
+
+    // Bit of key in a level of size bits
+    static uint64_t level_position(const kmer_key& key, uint64_t level, uint64_t size)
+    {
+      uint64_t h = mix64(key.h1 + (level+1)*key.h2);
+      return (uint64_t)(((unsigned __int128)h*size) >> 64);
+    }
+
+    uint64_t fingerprint(const kmer_key& key) const
+    {
+      return mix64(key.h2 ^ (key.h1 >> 32)) & mask(m_fingerprint_bits);
+    }
+
+    // Slot of key; number of kmers if it is in no level and no fallback key
+    uint64_t slot(const kmer_key& key) const
+    {
+      for (uint64_t l = 0; l+1 < m_levels.size(); ++l) {
+        uint64_t p = m_levels[l] + level_position(key, l, m_levels[l+1]-m_levels[l]);
+        if (m_bits[p]) {
+          return m_bits_rank(p);
+        }
+      }
+      uint64_t lo = 0;
+      uint64_t hi = m_fallback.size()/2;
+      while (lo < hi) {
+        uint64_t mid = lo + (hi-lo)/2;
+        uint64_t h1 = m_fallback[2*mid];
+        uint64_t h2 = m_fallback[2*mid+1];
+        if (h1 < key.h1 || (h1 == key.h1 && h2 < key.h2)) {
+          lo = mid+1;
+        } else {
+          hi = mid;
+        }
+      }
+      if (lo < m_fallback.size()/2 && m_fallback[2*lo] == key.h1 && m_fallback[2*lo+1] == key.h2) {
+        return m_ones+lo;
+      }
+      return m_entries.size();
+    }
+
+  public:
+    typedef uint64_t size_type;
+
+    kmer_index() :
+      m_k(0), m_graph_id(0), m_nodes(0), m_fingerprint_bits(0),
+      m_node_bits(0), m_offset_bits(0), m_ones(0) { }
+
+    // Index of keys, the hashes of the kmers of nodes nodes of the graph
+    // graph_id, in node order: the kmers of node v are keys[node_starts[v]]
+    // up to keys[node_starts[v+1]], by their offset in v. Takes about 25
+    // bytes per kmer besides the index.
+    kmer_index(
+      uint64_t k,
+      uint64_t graph_id,
+      const vector<kmer_key>& keys,
+      const vector<uint64_t>& node_starts,
+      uint64_t fingerprint_bits,
+      uint64_t threads=1) :
+      m_k(k), m_graph_id(graph_id), m_nodes(node_starts.size()-1), m_ones(0)
+    {
+      uint64_t n = keys.size();
+      uint64_t max_offset = 0;
+      for (uint64_t v = 0; v < m_nodes; ++v) {
+        uint64_t kmers = node_starts[v+1]-node_starts[v];
+        max_offset = (kmers > max_offset+1) ? kmers-1 : max_offset;
+      }
+      m_node_bits = width(m_nodes ? m_nodes-1 : 0);
+      m_offset_bits = width(max_offset);
+      m_fingerprint_bits = (fingerprint_bits+m_node_bits+m_offset_bits > 64) ?
+                           64-m_node_bits-m_offset_bits : fingerprint_bits;
+      // Levels, as words of bits that kmers hit once
+      vector<uint8_t> placed(n, 0);
+      vector<uint64_t> starts(1, 0);
+      vector<vector<uint64_t>> levels;
+      uint64_t left = n;
+      for (uint64_t l = 0; l < max_levels && left > 0; ++l) {
+        uint64_t size = (2*left+63)/64*64;
+        vector<uint64_t> hit(size/64, 0);
+        vector<uint64_t> collision(size/64, 0);
+        #pragma omp parallel for num_threads(threads) schedule(static)
+        for (uint64_t i = 0; i < n; ++i) {
+          if (!placed[i]) {
+            uint64_t p = level_position(keys[i], l, size);
+            uint64_t bit = 1ULL << (p%64);
+            if (__atomic_fetch_or(&hit[p/64], bit, __ATOMIC_RELAXED) & bit) {
+              __atomic_fetch_or(&collision[p/64], bit, __ATOMIC_RELAXED);
+            }
+          }
+        }
+        uint64_t level_placed = 0;
+        #pragma omp parallel for num_threads(threads) schedule(static) reduction(+:level_placed)
+        for (uint64_t i = 0; i < n; ++i) {
+          if (!placed[i]) {
+            uint64_t p = level_position(keys[i], l, size);
+            if (!(collision[p/64] & (1ULL << (p%64)))) {
+              placed[i] = 1;
+              ++level_placed;
+            }
+          }
+        }
+        for (uint64_t w = 0; w < hit.size(); ++w) {
+          hit[w] &= ~collision[w];
+        }
+        left -= level_placed;
+        starts.push_back(starts.back()+size);
+        levels.emplace_back(move(hit));
+      }
+      m_levels = int_vector<64>(starts.size());
+      for (uint64_t l = 0; l < starts.size(); ++l) {
+        m_levels[l] = starts[l];
+      }
+      bit_vector bits(starts.back(), 0);
+      for (uint64_t l = 0; l < levels.size(); ++l) {
+        for (uint64_t w = 0; w < levels[l].size(); ++w) {
+          for (uint64_t word = levels[l][w]; word; word &= word-1) {
+            bits[starts[l] + 64*w + __builtin_ctzll(word)] = 1;
+          }
+        }
+        vector<uint64_t>().swap(levels[l]);
+      }
+      m_bits = bit_vector_il<512>(bits);
+      m_bits_rank = bit_vector_il<512>::rank_1_type(&m_bits);
+      m_ones = n-left;
+      vector<kmer_key> fallback;
+      for (uint64_t i = 0; i < n; ++i) {
+        if (!placed[i]) {
+          fallback.emplace_back(keys[i]);
+        }
+      }
+      vector<uint8_t>().swap(placed);
+      sort(fallback.begin(), fallback.end(), [](const kmer_key& a, const kmer_key& b) {
+        return a.h1 < b.h1 || (a.h1 == b.h1 && a.h2 < b.h2);
+      });
+      m_fallback = int_vector<64>(2*fallback.size());
+      for (uint64_t i = 0; i < fallback.size(); ++i) {
+        m_fallback[2*i] = fallback[i].h1;
+        m_fallback[2*i+1] = fallback[i].h2;
+      }
+      // Entries, by the slots of the kmers
+      m_entries = int_vector<>(n, 0, (uint8_t)(m_fingerprint_bits+m_node_bits+m_offset_bits));
+      vector<uint64_t> slots(n);
+      #pragma omp parallel for num_threads(threads) schedule(static)
+      for (uint64_t i = 0; i < n; ++i) {
+        slots[i] = slot(keys[i]);
+      }
+      for (uint64_t v = 0; v < m_nodes; ++v) {
+        for (uint64_t i = node_starts[v]; i < node_starts[v+1]; ++i) {
+          uint64_t entry = (v << m_offset_bits) | (i-node_starts[v]);
+          if (m_fingerprint_bits > 0) {
+            entry |= fingerprint(keys[i]) << (m_node_bits+m_offset_bits);
+          }
+          m_entries[slots[i]] = entry;
+        }
+      }
+    }
+
+    kmer_index(const kmer_index& index)
+    {
+      *this = index;
+    }
+
+    kmer_index(kmer_index&& index)
+    {
+      *this = move(index);
+    }
+
+    kmer_index& operator=(const kmer_index& index)
+    {
+      if (this != &index) {
+        m_k = index.m_k;
+        m_graph_id = index.m_graph_id;
+        m_nodes = index.m_nodes;
+        m_fingerprint_bits = index.m_fingerprint_bits;
+        m_node_bits = index.m_node_bits;
+        m_offset_bits = index.m_offset_bits;
+        m_levels = index.m_levels;
+        m_bits = index.m_bits;
+        m_bits_rank = index.m_bits_rank;
+        m_bits_rank.set_vector(&m_bits);
+        m_fallback = index.m_fallback;
+        m_entries = index.m_entries;
+        m_ones = index.m_ones;
+      }
+      return *this;
+    }
+
+    kmer_index& operator=(kmer_index&& index)
+    {
+      if (this != &index) {
+        m_k = index.m_k;
+        m_graph_id = index.m_graph_id;
+        m_nodes = index.m_nodes;
+        m_fingerprint_bits = index.m_fingerprint_bits;
+        m_node_bits = index.m_node_bits;
+        m_offset_bits = index.m_offset_bits;
+        m_levels = move(index.m_levels);
+        m_bits = move(index.m_bits);
+        m_bits_rank = move(index.m_bits_rank);
+        m_bits_rank.set_vector(&m_bits);
+        m_fallback = move(index.m_fallback);
+        m_entries = move(index.m_entries);
+        m_ones = index.m_ones;
+      }
+      return *this;
+    }
+
+    uint64_t get_k() const
+    {
+      return m_k;
+    }
+
+    // CDBG::graph_id of the graph the index was built for
+    uint64_t graph_id() const
+    {
+      return m_graph_id;
+    }
+
+    // Nodes of the graph the index was built for
+    uint64_t nodes() const
+    {
+      return m_nodes;
+    }
+
+    uint64_t kmers() const
+    {
+      return m_entries.size();
+    }
+
+    uint64_t fingerprint_bits() const
+    {
+      return m_fingerprint_bits;
+    }
+
+    // Node of the kmer of length k at s and the offset of the kmer in the
+    // node; false if it does not occur (see above for false positives)
+    bool find(const char* s, uint64_t& node, uint64_t& offset) const
+    {
+      kmer_key key = hash_kmer(s, m_k);
+      uint64_t i = slot(key);
+      if (i >= m_entries.size()) {
+        return false;
+      }
+      uint64_t entry = m_entries[i];
+      if (m_fingerprint_bits > 0 &&
+          (entry >> (m_node_bits+m_offset_bits)) != fingerprint(key)) {
+        return false;
+      }
+      node = (entry >> m_offset_bits) & mask(m_node_bits);
+      offset = entry & mask(m_offset_bits);
+      return true;
+    }
+
+    size_type serialize(
+      ostream& out,
+      structure_tree_node* v=nullptr,
+      string name="") const
+    {
+      structure_tree_node* child = structure_tree::add_child(v, name, "kmer_index");
+      size_type written_bytes = 0;
+      written_bytes += write_member(m_k, out, child, "k");
+      written_bytes += write_member(m_graph_id, out, child, "graph_id");
+      written_bytes += write_member(m_nodes, out, child, "nodes");
+      written_bytes += write_member(m_fingerprint_bits, out, child, "fingerprint_bits");
+      written_bytes += write_member(m_node_bits, out, child, "node_bits");
+      written_bytes += write_member(m_offset_bits, out, child, "offset_bits");
+      written_bytes += m_levels.serialize(out, child, "levels");
+      written_bytes += m_bits.serialize(out, child, "bits");
+      written_bytes += m_bits_rank.serialize(out, child, "bits_rank");
+      written_bytes += m_fallback.serialize(out, child, "fallback");
+      written_bytes += m_entries.serialize(out, child, "entries");
+      structure_tree::add_size(child, written_bytes);
+      return written_bytes;
+    }
+
+    void load(istream& in)
+    {
+      read_member(m_k, in);
+      read_member(m_graph_id, in);
+      read_member(m_nodes, in);
+      read_member(m_fingerprint_bits, in);
+      read_member(m_node_bits, in);
+      read_member(m_offset_bits, in);
+      m_levels.load(in);
+      m_bits.load(in);
+      m_bits_rank.load(in, &m_bits);
+      m_fallback.load(in);
+      m_entries.load(in);
+      m_ones = m_bits.size() ? m_bits_rank(m_bits.size()) : 0;
+    }
+};
+
+
+}  // cdbg
+
+
+#endif
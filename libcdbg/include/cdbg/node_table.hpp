@@ -0,0 +1,246 @@
+#ifndef NODE_TABLE_HPP
+#define NODE_TABLE_HPP
+
+// std
+#include <iostream>  // istream, ostream
+#include <iterator>  // forward_iterator_tag
+#include <string>
+#include <utility>  // move
+#include <vector>
+// sdsl
+#include <sdsl/bits.hpp>  // bits
+#include <sdsl/int_vector.hpp>  // bit_vector, int_vector
+#include <sdsl/io.hpp>  // serialize
+#include <sdsl/rank_support_v.hpp>  // rank_support_v
+#include <sdsl/structure_tree.hpp>  // structure_tree, structure_tree_node
+
+
+using std::forward_iterator_tag;
+using std::istream;
+using std::move;
+using std::ostream;
+using std::string;
+using std::vector;
+using sdsl::bit_vector;
+using sdsl::int_vector;
+using sdsl::rank_support_v;
+using sdsl::structure_tree;
+using sdsl::structure_tree_node;
+
+
+namespace cdbg {
+
+
+struct node_c
+{
+  uint64_t lb;  // lb of prefix kmer
+  uint64_t len;
+  uint64_t size;
+  uint64_t first_lb;  // lb of suffix kmer
+  node_c(
+    uint64_t _lb=0,
+    uint64_t _len=0,
+    uint64_t _size=0,
+    uint64_t _first_lb=0) :
+    lb(_lb), len(_len), size(_size), first_lb(_first_lb) { }
+};
+
+
+// The nodes of a compressed de Bruijn graph as bit-packed columns. first_lb
+// differs from lb only for nodes longer than k; it is stored for those nodes
+// only, in node order, and found by a rank on the extended bit vector.
+class node_table
+{
+  private:
+    int_vector<> m_lb;
+    int_vector<> m_len;
+    int_vector<> m_size;
+    int_vector<> m_first_lb;
+    bit_vector m_extended;  // first_lb != lb
+    rank_support_v<> m_extended_rank;
+
+    static uint8_t width(uint64_t max)
+    {
+      return max ? sdsl::bits::hi(max)+1 : 1;
+    }
+
+  public:
+    typedef uint64_t size_type;
+
+    class const_iterator
+    {
+      private:
+        const node_table* m_table;
+        uint64_t m_idx;
+
+      public:
+        typedef forward_iterator_tag iterator_category;
+        typedef node_c value_type;
+        typedef int64_t difference_type;
+        typedef const node_c* pointer;
+        typedef node_c reference;
+
+        const_iterator(const node_table* table, uint64_t idx) :
+          m_table(table), m_idx(idx) { }
+        node_c operator*() const { return (*m_table)[m_idx]; }
+        const_iterator& operator++() { ++m_idx; return *this; }
+        bool operator==(const const_iterator& it) const { return m_idx == it.m_idx; }
+        bool operator!=(const const_iterator& it) const { return m_idx != it.m_idx; }
+    };
+
+    node_table() { }
+
+    explicit node_table(const vector<node_c>& nodes)
+    {
+      uint64_t max_lb = 0;
+      uint64_t max_len = 0;
+      uint64_t max_size = 0;
+      uint64_t extended = 0;
+      for (const auto& node : nodes) {
+        max_lb = (node.lb > max_lb) ? node.lb : max_lb;
+        max_lb = (node.first_lb > max_lb) ? node.first_lb : max_lb;
+        max_len = (node.len > max_len) ? node.len : max_len;
+        max_size = (node.size > max_size) ? node.size : max_size;
+        extended += (node.first_lb != node.lb);
+      }
+      m_lb = int_vector<>(nodes.size(), 0, width(max_lb));
+      m_len = int_vector<>(nodes.size(), 0, width(max_len));
+      m_size = int_vector<>(nodes.size(), 0, width(max_size));
+      m_first_lb = int_vector<>(extended, 0, width(max_lb));
+      m_extended = bit_vector(nodes.size(), 0);
+      for (uint64_t i = 0, j = 0; i < nodes.size(); ++i) {
+        m_lb[i] = nodes[i].lb;
+        m_len[i] = nodes[i].len;
+        m_size[i] = nodes[i].size;
+        if (nodes[i].first_lb != nodes[i].lb) {
+          m_extended[i] = 1;
+          m_first_lb[j++] = nodes[i].first_lb;
+        }
+      }
+      m_extended_rank = rank_support_v<>(&m_extended);
+    }
+
+    node_table(const node_table& t) :
+      m_lb(t.m_lb),
+      m_len(t.m_len),
+      m_size(t.m_size),
+      m_first_lb(t.m_first_lb),
+      m_extended(t.m_extended),
+      m_extended_rank(t.m_extended_rank)
+    {
+      m_extended_rank.set_vector(&m_extended);
+    }
+
+    node_table(node_table&& t) :
+      m_lb(move(t.m_lb)),
+      m_len(move(t.m_len)),
+      m_size(move(t.m_size)),
+      m_first_lb(move(t.m_first_lb)),
+      m_extended(move(t.m_extended)),
+      m_extended_rank(move(t.m_extended_rank))
+    {
+      m_extended_rank.set_vector(&m_extended);
+    }
+
+    node_table& operator=(node_table&& t)
+    {
+      if (this != &t) {
+        m_lb = move(t.m_lb);
+        m_len = move(t.m_len);
+        m_size = move(t.m_size);
+        m_first_lb = move(t.m_first_lb);
+        m_extended = move(t.m_extended);
+        m_extended_rank = move(t.m_extended_rank);
+        m_extended_rank.set_vector(&m_extended);
+      }
+      return *this;
+    }
+
+    node_table& operator=(const node_table& t)
+    {
+      if (this != &t) {
+        m_lb = t.m_lb;
+        m_len = t.m_len;
+        m_size = t.m_size;
+        m_first_lb = t.m_first_lb;
+        m_extended = t.m_extended;
+        m_extended_rank = t.m_extended_rank;
+        m_extended_rank.set_vector(&m_extended);
+      }
+      return *this;
+    }
+
+    uint64_t size() const
+    {
+      return m_lb.size();
+    }
+
+    uint64_t lb(uint64_t i) const
+    {
+      return m_lb[i];
+    }
+
+    uint64_t len(uint64_t i) const
+    {
+      return m_len[i];
+    }
+
+    // Size of the suffix array interval of the node, i.e. its occurrences
+    uint64_t interval_size(uint64_t i) const
+    {
+      return m_size[i];
+    }
+
+    uint64_t first_lb(uint64_t i) const
+    {
+      return m_extended[i] ? (uint64_t)m_first_lb[m_extended_rank(i)] : (uint64_t)m_lb[i];
+    }
+
+    node_c operator[](uint64_t i) const
+    {
+      return node_c(lb(i), len(i), interval_size(i), first_lb(i));
+    }
+
+    const_iterator begin() const
+    {
+      return const_iterator(this, 0);
+    }
+
+    const_iterator end() const
+    {
+      return const_iterator(this, size());
+    }
+
+    size_type serialize(
+      ostream& out,
+      structure_tree_node* v=nullptr,
+      string name="") const
+    {
+      structure_tree_node* child = structure_tree::add_child(v, name, "node_table");
+      size_type written_bytes = 0;
+      written_bytes += m_lb.serialize(out, child, "lb");
+      written_bytes += m_len.serialize(out, child, "len");
+      written_bytes += m_size.serialize(out, child, "size");
+      written_bytes += m_first_lb.serialize(out, child, "first_lb");
+      written_bytes += m_extended.serialize(out, child, "extended");
+      written_bytes += m_extended_rank.serialize(out, child, "extended_rank");
+      structure_tree::add_size(child, written_bytes);
+      return written_bytes;
+    }
+
+    void load(istream& in)
+    {
+      m_lb.load(in);
+      m_len.load(in);
+      m_size.load(in);
+      m_first_lb.load(in);
+      m_extended.load(in);
+      m_extended_rank.load(in, &m_extended);
+    }
+};
+
+
+}  // cdbg
+
+
+#endif
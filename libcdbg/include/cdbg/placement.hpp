@@ -0,0 +1,143 @@
+#ifndef PLACEMENT_HPP
+#define PLACEMENT_HPP
+
+// std
+#include <memory>  // unique_ptr
+#include <string>
+#include <thread>  // thread
+#include <vector>
+// local
+#include "cdbg/io/implicit_stream.hpp"  // load_implicit
+
+
+using std::string;
+using std::thread;
+using std::unique_ptr;
+using std::vector;
+
+
+namespace cdbg {
+
+
+// Pages that back the structures of a loaded graph
+enum class page_mode : uint8_t
+{
+  normal = 0,  // 4 KiB pages
+  transparent = 1,  // transparent huge pages, collapsed by the kernel
+  huge = 2  // a pool of explicit huge pages (vm.nr_hugepages), via sdsl
+};
+
+
+string page_mode_name(page_mode);
+bool parse_page_mode(const string&, page_mode&);
+
+
+// CPUs of every NUMA node, from /sys/devices/system/node; a single node with
+// all CPUs if the system does not tell
+vector<vector<uint64_t>> numa_node_cpus();
+
+
+// Restricts the calling thread to cpus; false if the system refuses
+bool bind_thread(const vector<uint64_t>& cpus);
+
+
+// Makes sdsl allocate from a pool of bytes of explicit huge pages from now
+// on; has to be called once, before the graph is loaded. False (with a
+// message) if the pool cannot be mapped.
+bool use_huge_pages(uint64_t bytes);
+
+
+// Pool of explicit huge pages that copies loaded copies of the graph in
+// filename need, with room for the rank and select structures
+uint64_t huge_page_pool_bytes(const string& filename, uint64_t copies);
+
+
+// Asks the kernel to back the anonymous memory of the process that is large
+// enough with transparent huge pages, which khugepaged then collapses in the
+// background; call it after loading. Returns the advised bytes.
+uint64_t advise_huge_pages();
+
+
+// A graph for query threads spread over NUMA nodes: with replicate one copy
+// per NUMA node, each loaded by a thread bound to the node, so the first
+// touch puts its pages into local memory; otherwise a single copy. Worker
+// threads bind themselves to a node round robin and query its copy, so no
+// wavelet tree rank crosses the interconnect.
+template<class t_cdbg>
+class numa_replicas
+{
+  private:
+    vector<vector<uint64_t>> m_cpus;
+    vector<unique_ptr<t_cdbg>> m_graphs;
+
+  public:
+    // False (with a message) if a copy cannot be loaded
+    bool load(const string& filename, bool replicate, page_mode mode=page_mode::normal)
+    {
+      m_cpus = numa_node_cpus();
+      m_graphs.clear();
+      uint64_t copies = replicate ? m_cpus.size() : 1;
+      if (mode == page_mode::huge &&
+          !use_huge_pages(huge_page_pool_bytes(filename, copies))) {
+        return false;
+      }
+      // The copies load concurrently, each on its own node
+      vector<char> ok(copies, 0);
+      vector<thread> loaders;
+      for (uint64_t node = 0; node < copies; ++node) {
+        m_graphs.emplace_back(new t_cdbg());
+      }
+      for (uint64_t node = 0; node < copies; ++node) {
+        loaders.emplace_back([&, node]() {
+          if (replicate) {
+            bind_thread(m_cpus[node]);
+          }
+          ok[node] = io::load_implicit(*m_graphs[node], filename);
+        });
+      }
+      for (auto& loader : loaders) {
+        loader.join();
+      }
+      for (uint64_t node = 0; node < copies; ++node) {
+        if (!ok[node]) {
+          return false;
+        }
+      }
+      if (mode == page_mode::transparent) {
+        advise_huge_pages();
+      }
+      return true;
+    }
+
+    uint64_t numa_nodes() const
+    {
+      return m_cpus.size();
+    }
+
+    uint64_t copies() const
+    {
+      return m_graphs.size();
+    }
+
+    // The copy of the graph on NUMA node node, or the only one
+    const t_cdbg& graph(uint64_t node=0) const
+    {
+      return *m_graphs[node % m_graphs.size()];
+    }
+
+    // Binds the calling thread, the worker-th query thread, to the CPUs of
+    // its NUMA node if the graph is replicated and returns the local copy
+    const t_cdbg& bind_worker(uint64_t worker) const
+    {
+      if (m_graphs.size() > 1) {
+        bind_thread(m_cpus[worker % m_cpus.size()]);
+      }
+      return graph(worker % m_cpus.size());
+    }
+};
+
+
+}  // cdbg
+
+
+#endif
@@ -0,0 +1,406 @@
+#ifndef SMALL_ALPHABET_BWT_HPP
+#define SMALL_ALPHABET_BWT_HPP
+
+// std
+#include <iostream>  // istream, ostream
+#include <string>
+#include <utility>  // pair, swap
+#include <vector>
+// sdsl
+#include <sdsl/bits.hpp>  // bits
+#include <sdsl/int_vector.hpp>  // int_vector
+#include <sdsl/io.hpp>  // read_member, write_member
+#include <sdsl/sdsl_concepts.hpp>  // byte_alphabet_tag, wt_tag
+#include <sdsl/structure_tree.hpp>  // structure_tree, structure_tree_node
+
+
+using std::istream;
+using std::make_pair;
+using std::ostream;
+using std::pair;
+using std::string;
+using std::vector;
+using sdsl::int_vector;
+using sdsl::read_member;
+using sdsl::structure_tree;
+using sdsl::structure_tree_node;
+using sdsl::write_member;
+
+
+namespace cdbg {
+
+
+// The symbols of DNA texts: the sentinels 0 and 1 and A, C, G, N, T. Codes
+// keep the symbol order; symbols outside of the alphabet get code size.
+struct dna_alphabet
+{
+  static constexpr uint8_t size = 7;
+
+  static constexpr uint8_t code(uint8_t c)
+  {
+    return (c <= 1) ? c :
+           (c == 'A') ? 2 :
+           (c == 'C') ? 3 :
+           (c == 'G') ? 4 :
+           (c == 'N') ? 5 :
+           (c == 'T') ? 6 : size;
+  }
+
+  static constexpr uint8_t symbol(uint8_t x)
+  {
+    return (x <= 1) ? x :
+           (x == 2) ? 'A' :
+           (x == 3) ? 'C' :
+           (x == 4) ? 'G' :
+           (x == 5) ? 'N' : 'T';
+  }
+};
+
+
+// Drop-in replacement of the byte wavelet tree of the BWT (t_wt of
+// compressed_debruijn_graph) for texts over an alphabet of at most 7 symbols.
+// The BWT is split into blocks of 256 symbols, each of which interleaves the
+// occurrence counts of all symbols before the block with the 3-bit codes of
+// its symbols stored as bit planes. A rank, and so an LF step, reads a single
+// block instead of walking the levels of a wavelet tree, and one block answers
+// the ranks of all symbols (interval_symbols). select binary searches the
+// block counts between sampled occurrences. All symbols of the text have to
+// be in t_alphabet, see contains.
+template<class t_alphabet=dna_alphabet>
+class small_alphabet_bwt
+{
+  static_assert(t_alphabet::size < 8, "3-bit codes, one for symbols outside");
+
+  public:
+    typedef uint64_t size_type;
+    typedef uint8_t value_type;
+    typedef sdsl::wt_tag index_category;
+    typedef sdsl::byte_alphabet_tag alphabet_category;
+
+  private:
+    // A block is 16 words: the counts of the 8 codes relative to the
+    // superblock as 32-bit halves of words 0-3, then 3 planes of 4 words
+    static const uint64_t block_size = 256;
+    static const uint64_t block_words = 16;
+    static const uint64_t plane_words = block_size/64;
+    static const uint64_t superblock_shift = 24;  // 2^32 symbols
+    static const uint64_t sample_rate = 4096;  // occurrences per select sample
+
+    size_type m_size = 0;
+    size_type m_sigma = 0;
+    int_vector<64> m_blocks;
+    int_vector<64> m_superblocks;  // 8 absolute counts per superblock
+    int_vector<> m_samples;  // block of every sample_rate-th occurrence
+    int_vector<> m_sample_starts;  // first sample of every code
+    uint8_t m_code[256];
+
+    void init_codes()
+    {
+      for (uint64_t c = 0; c < 256; ++c) {
+        m_code[c] = t_alphabet::code(c);
+      }
+    }
+
+    uint64_t blocks() const
+    {
+      return m_blocks.size()/block_words;
+    }
+
+    // Occurrences of code x before block b
+    uint64_t block_rank(uint64_t b, uint8_t x) const
+    {
+      uint64_t word = m_blocks[b*block_words + (x>>1)];
+      return m_superblocks[(b>>superblock_shift)*8 + x] +
+             ((word >> (32*(x&1))) & 0xFFFFFFFFULL);
+    }
+
+    // Positions of code x in word w of the block planes
+    static uint64_t match(const uint64_t* planes, uint64_t w, uint8_t x)
+    {
+      return ~(planes[w] ^ (0ULL - (x&1))) &
+             ~(planes[plane_words+w] ^ (0ULL - ((x>>1)&1))) &
+             ~(planes[2*plane_words+w] ^ (0ULL - ((x>>2)&1)));
+    }
+
+    uint64_t rank_code(uint64_t i, uint8_t x) const
+    {
+      uint64_t b = i/block_size;
+      const uint64_t* planes = m_blocks.data() + b*block_words + 4;
+      uint64_t r = block_rank(b, x);
+      uint64_t offset = i % block_size;
+      for (uint64_t w = 0; w < offset/64; ++w) {
+        r += sdsl::bits::cnt(match(planes, w, x));
+      }
+      if (offset % 64) {
+        uint64_t mask = (1ULL << (offset % 64)) - 1;
+        r += sdsl::bits::cnt(match(planes, offset/64, x) & mask);
+      }
+      return r;
+    }
+
+    uint8_t code_at(uint64_t i) const
+    {
+      const uint64_t* planes = m_blocks.data() + (i/block_size)*block_words + 4;
+      uint64_t w = (i % block_size)/64;
+      uint64_t bit = i % 64;
+      return ((planes[w] >> bit) & 1) |
+             (((planes[plane_words+w] >> bit) & 1) << 1) |
+             (((planes[2*plane_words+w] >> bit) & 1) << 2);
+    }
+
+    void copy(const small_alphabet_bwt& bwt)
+    {
+      m_size = bwt.m_size;
+      m_sigma = bwt.m_sigma;
+      m_blocks = bwt.m_blocks;
+      m_superblocks = bwt.m_superblocks;
+      m_samples = bwt.m_samples;
+      m_sample_starts = bwt.m_sample_starts;
+    }
+
+  public:
+    const size_type& sigma = m_sigma;
+
+    small_alphabet_bwt()
+    {
+      init_codes();
+    }
+
+    template<class t_buf>
+    small_alphabet_bwt(t_buf& buf, size_type size) : m_size(size)
+    {
+      init_codes();
+      uint64_t n_blocks = size/block_size + 1;
+      m_blocks = int_vector<64>(n_blocks*block_words, 0);
+      m_superblocks = int_vector<64>(((n_blocks-1) >> superblock_shift)*8 + 8, 0);
+      uint64_t counts[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+      vector<vector<uint64_t>> samples(8);
+      for (uint64_t b = 0, i = 0; b < n_blocks; ++b) {
+        uint64_t* block = m_blocks.data() + b*block_words;
+        uint64_t* super = m_superblocks.data() + (b>>superblock_shift)*8;
+        for (uint8_t x = 0; x < 8; ++x) {
+          if ((b & ((1ULL << superblock_shift) - 1)) == 0) {
+            super[x] = counts[x];
+          }
+          block[x>>1] |= (counts[x]-super[x]) << (32*(x&1));
+        }
+        for (uint64_t j = 0; j < block_size && i < size; ++j, ++i) {
+          uint8_t x = m_code[(uint8_t)buf[i]];
+          for (uint64_t p = 0; p < 3; ++p) {
+            block[4 + p*plane_words + j/64] |= (uint64_t)((x>>p) & 1) << (j % 64);
+          }
+          if (counts[x]++ % sample_rate == 0) {
+            samples[x].push_back(b);
+          }
+        }
+      }
+      m_sample_starts = int_vector<>(9, 0);
+      for (uint8_t x = 0; x < 8; ++x) {
+        m_sample_starts[x+1] = m_sample_starts[x] + samples[x].size();
+        m_sigma += (x < t_alphabet::size && counts[x] > 0);
+      }
+      m_samples = int_vector<>(m_sample_starts[8], 0, sdsl::bits::hi(n_blocks)+1);
+      for (uint64_t x = 0, s = 0; x < 8; ++x) {
+        for (const auto& b : samples[x]) {
+          m_samples[s++] = b;
+        }
+      }
+    }
+
+    small_alphabet_bwt(const small_alphabet_bwt& bwt)
+    {
+      init_codes();
+      copy(bwt);
+    }
+
+    small_alphabet_bwt(small_alphabet_bwt&& bwt)
+    {
+      init_codes();
+      swap(bwt);
+    }
+
+    small_alphabet_bwt& operator=(const small_alphabet_bwt& bwt)
+    {
+      if (this != &bwt) {
+        copy(bwt);
+      }
+      return *this;
+    }
+
+    small_alphabet_bwt& operator=(small_alphabet_bwt&& bwt)
+    {
+      swap(bwt);
+      return *this;
+    }
+
+    // Bits taken by the BWT of size symbols: 4 per symbol for the blocks,
+    // the superblock counts and a select sample for at most every
+    // sample_rate-th symbol plus one per code
+    static uint64_t size_in_bits(size_type size)
+    {
+      uint64_t n_blocks = size/block_size + 1;
+      uint64_t words = n_blocks*block_words + ((n_blocks-1) >> superblock_shift)*8 + 8;
+      uint64_t samples = size/sample_rate + 8;
+      return 64*words + samples*(sdsl::bits::hi(n_blocks)+1);
+    }
+
+    // True if all symbols of the text in buf are in the alphabet
+    template<class t_buf>
+    static bool contains(t_buf& buf, size_type size)
+    {
+      for (uint64_t i = 0; i < size; ++i) {
+        if (t_alphabet::code((uint8_t)buf[i]) >= t_alphabet::size) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    size_type size() const
+    {
+      return m_size;
+    }
+
+    bool empty() const
+    {
+      return m_size == 0;
+    }
+
+    value_type operator[](size_type i) const
+    {
+      return t_alphabet::symbol(code_at(i));
+    }
+
+    // Occurrences of c in [0..i-1]
+    size_type rank(size_type i, value_type c) const
+    {
+      uint8_t x = m_code[c];
+      return (x < t_alphabet::size) ? rank_code(i, x) : 0;
+    }
+
+    // Position of the i-th occurrence of c, i > 0
+    size_type select(size_type i, value_type c) const
+    {
+      uint8_t x = m_code[c];
+      uint64_t s = m_sample_starts[x] + (i-1)/sample_rate;
+      uint64_t lo = m_samples[s];
+      uint64_t hi = (s+1 < m_sample_starts[x+1]) ? m_samples[s+1]+1 : blocks();
+      while (hi-lo > 1) {
+        uint64_t mid = lo + (hi-lo)/2;
+        if (block_rank(mid, x) < i) {
+          lo = mid;
+        } else {
+          hi = mid;
+        }
+      }
+      const uint64_t* planes = m_blocks.data() + lo*block_words + 4;
+      uint64_t r = i - block_rank(lo, x);
+      uint64_t w = 0;
+      uint64_t m = match(planes, w, x);
+      for (uint64_t cnt = sdsl::bits::cnt(m); cnt < r; cnt = sdsl::bits::cnt(m)) {
+        r -= cnt;
+        m = match(planes, ++w, x);
+      }
+      return lo*block_size + w*64 + sdsl::bits::sel(m, r);
+    }
+
+    // (rank(i, c), c) for the symbol c at i
+    pair<size_type, value_type> inverse_select(size_type i) const
+    {
+      uint8_t x = code_at(i);
+      return make_pair(rank_code(i, x), t_alphabet::symbol(x));
+    }
+
+    // The k distinct symbols cs of [i..j-1] with their ranks at i and j
+    template<class t_c>
+    void interval_symbols(
+      size_type i,
+      size_type j,
+      size_type& k,
+      vector<t_c>& cs,
+      vector<size_type>& rank_c_i,
+      vector<size_type>& rank_c_j) const
+    {
+      k = 0;
+      if (i >= j) {
+        return;
+      }
+      if (i+1 == j) {
+        uint8_t x = code_at(i);
+        cs[0] = t_alphabet::symbol(x);
+        rank_c_i[0] = rank_code(i, x);
+        rank_c_j[0] = rank_c_i[0]+1;
+        k = 1;
+        return;
+      }
+      for (uint8_t x = 0; x < t_alphabet::size; ++x) {
+        uint64_t r_i = rank_code(i, x);
+        uint64_t r_j = rank_code(j, x);
+        if (r_i < r_j) {
+          cs[k] = t_alphabet::symbol(x);
+          rank_c_i[k] = r_i;
+          rank_c_j[k] = r_j;
+          ++k;
+        }
+      }
+    }
+
+    void swap(small_alphabet_bwt& bwt)
+    {
+      std::swap(m_size, bwt.m_size);
+      std::swap(m_sigma, bwt.m_sigma);
+      m_blocks.swap(bwt.m_blocks);
+      m_superblocks.swap(bwt.m_superblocks);
+      m_samples.swap(bwt.m_samples);
+      m_sample_starts.swap(bwt.m_sample_starts);
+    }
+
+    size_type serialize(
+      ostream& out,
+      structure_tree_node* v=nullptr,
+      string name="") const
+    {
+      structure_tree_node* child = structure_tree::add_child(v, name, "small_alphabet_bwt");
+      size_type written_bytes = 0;
+      written_bytes += write_member(m_size, out, child, "size");
+      written_bytes += write_member(m_sigma, out, child, "sigma");
+      written_bytes += m_blocks.serialize(out, child, "blocks");
+      written_bytes += m_superblocks.serialize(out, child, "superblocks");
+      written_bytes += m_samples.serialize(out, child, "samples");
+      written_bytes += m_sample_starts.serialize(out, child, "sample_starts");
+      structure_tree::add_size(child, written_bytes);
+      return written_bytes;
+    }
+
+    void load(istream& in)
+    {
+      read_member(m_size, in);
+      read_member(m_sigma, in);
+      m_blocks.load(in);
+      m_superblocks.load(in);
+      m_samples.load(in);
+      m_sample_starts.load(in);
+    }
+};
+
+
+// Found by argument dependent lookup in construct_partial_lcp, like the one
+// of sdsl for its wavelet trees
+template<class t_alphabet, class t_c>
+void interval_symbols(
+  const small_alphabet_bwt<t_alphabet>& bwt,
+  uint64_t i,
+  uint64_t j,
+  uint64_t& k,
+  vector<t_c>& cs,
+  vector<uint64_t>& rank_c_i,
+  vector<uint64_t>& rank_c_j)
+{
+  bwt.interval_symbols(i, j, k, cs, rank_c_i, rank_c_j);
+}
+
+
+}  // cdbg
+
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef SPACE_HPP
+#define SPACE_HPP
+
+// std
+#include <algorithm>  // sort
+#include <iostream>  // ostream
+#include <memory>  // unique_ptr
+#include <string>
+#include <vector>
+// sdsl
+#include <sdsl/structure_tree.hpp>  // structure_tree_node
+
+
+using std::ostream;
+using std::sort;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using sdsl::structure_tree_node;
+
+
+namespace cdbg {
+
+
+// A component of a serialized data structure and its parts, largest first
+struct space_node
+{
+  string name;
+  string type;
+  uint64_t bytes = 0;
+  vector<space_node> children;
+};
+
+
+// Sizes of a graph file and of the process that loaded it
+struct space_report
+{
+  string graph;  // file name
+  string profile;
+  uint64_t text_length = 0;  // bits per character are relative to it
+  uint64_t resident_before = 0;  // VmRSS before and after loading, in bytes
+  uint64_t resident_after = 0;
+  space_node root;
+};
+
+
+inline space_node space_tree(const structure_tree_node* v)
+{
+  space_node node;
+  node.name = v->name;
+  node.type = v->type;
+  node.bytes = v->size;
+  for (const auto& child : v->children) {
+    node.children.emplace_back(space_tree(child.second.get()));
+  }
+  sort(node.children.begin(), node.children.end(),
+    [](const space_node& a, const space_node& b) {
+      return a.bytes > b.bytes || (a.bytes == b.bytes && a.name < b.name);
+    });
+  return node;
+}
+
+
+// Components of t_obj with the sizes serialize reports for them
+template<class t_obj>
+space_node space_breakdown(const t_obj& obj, const string& name="graph")
+{
+  // A stream without buffer discards everything written to it
+  ostream null(nullptr);
+  unique_ptr<structure_tree_node> root(new structure_tree_node("root", "root"));
+  obj.serialize(null, root.get(), name);
+  return space_tree(root->children.begin()->second.get());
+}
+
+
+// Resident set size of this process in bytes (VmRSS of /proc/self/status),
+// 0 where it is not available
+uint64_t resident_memory();
+
+
+void write_space_json(const space_report& report, ostream& out);
+void write_space_html(const space_report& report, ostream& out);
+
+
+}  // cdbg
+
+
+#endif
@@ -0,0 +1,16 @@
+// local
+#include "cdbg/cdbg.hpp"  // compressed_debruijn_graph, wt_bv, wt_dna,
+                          // wt_rrr15
+
+
+namespace cdbg {
+
+
+// The profiles of cdbg.hpp
+template struct compressed_debruijn_graph<wt_bv, bit_vector, bit_vector_il<>>;
+template struct compressed_debruijn_graph<wt_bv, sd_vector<>, sd_vector<>>;
+template struct compressed_debruijn_graph<wt_rrr15, sd_vector<>, sd_vector<>>;
+template struct compressed_debruijn_graph<wt_dna, bit_vector, bit_vector_il<>>;
+
+
+}  // cdbg
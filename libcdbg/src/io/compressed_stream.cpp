@@ -0,0 +1,440 @@
+// std
+#include <algorithm>  // find, max, min
+#include <cstring>  // memcmp, memcpy, memset, strncpy
+#include <fstream>  // ifstream, ofstream
+#include <iostream>  // cerr, endl
+#include <string>
+#include <thread>  // thread
+#include <utility>  // pair
+#include <vector>
+// zstd
+#include <zstd.h>  // ZSTD_compress, ZSTD_compressBound, ZSTD_decompress,
+                   // ZSTD_getErrorName, ZSTD_isError
+// local
+#include "cdbg/io/compressed_stream.hpp"  // compressed_chunk, compressed_header,
+                                          // compressed_section
+
+
+using std::cerr;
+using std::endl;
+using std::find;
+using std::ifstream;
+using std::max;
+using std::memcmp;
+using std::memcpy;
+using std::memset;
+using std::min;
+using std::ofstream;
+using std::pair;
+using std::strncpy;
+using std::string;
+using std::thread;
+using std::vector;
+
+
+namespace cdbg {
+namespace io {
+
+
+static uint64_t thread_count(uint64_t threads)
+{
+  return threads ? threads : max(1u, thread::hardware_concurrency());
+}
+
+
+bool is_compressed(const string& filename)
+{
+  ifstream in(filename, std::ios::binary);
+  char magic[8];
+  in.read(magic, sizeof(magic));
+  return in && memcmp(magic, compressed_magic, sizeof(magic)) == 0;
+}
+
+
+bool read_compressed_directory(const string& filename, compressed_directory& directory)
+{
+  ifstream in(filename, std::ios::binary);
+  if (!in.is_open()) {
+    cerr << "Could not open '" << filename << "' for reading." << endl;
+    return false;
+  }
+  compressed_header& header = directory.header;
+  in.read((char*)&header, sizeof(header));
+  if (!in || memcmp(header.magic, compressed_magic, sizeof(header.magic)) != 0) {
+    cerr << "'" << filename << "' is not a compressed graph." << endl;
+    return false;
+  }
+  if (header.version != compressed_version) {
+    cerr << "Graph '" << filename << "' has compressed format version " << header.version;
+    cerr << ", expected " << compressed_version << "." << endl;
+    return false;
+  }
+  directory.sections.resize(header.sections);
+  directory.chunks.resize(header.chunks);
+  in.read((char*)directory.sections.data(), header.sections*sizeof(compressed_section));
+  in.read((char*)directory.chunks.data(), header.chunks*sizeof(compressed_chunk));
+  if (!in) {
+    cerr << "Graph '" << filename << "' has a truncated table of contents." << endl;
+    return false;
+  }
+  return true;
+}
+
+
+bool write_compressed(
+  const string& filename,
+  const string& raw,
+  const vector<pair<string, uint64_t>>& sections,
+  uint64_t profile,
+  int level,
+  uint64_t chunk_bytes,
+  uint64_t threads)
+{
+  compressed_directory directory;
+  for (uint64_t s = 0; s < sections.size(); ++s) {
+    compressed_section section;
+    memset(&section, 0, sizeof(section));
+    strncpy(section.name, sections[s].first.c_str(), sizeof(section.name)-1);
+    section.raw_offset = sections[s].second;
+    uint64_t end = (s+1 < sections.size()) ? sections[s+1].second : raw.size();
+    section.raw_bytes = end - section.raw_offset;
+    section.first_chunk = directory.chunks.size();
+    for (uint64_t offset = section.raw_offset; offset < end; offset += chunk_bytes) {
+      compressed_chunk chunk;
+      chunk.raw_bytes = min(chunk_bytes, end-offset);
+      chunk.offset = 0;
+      chunk.bytes = 0;
+      directory.chunks.emplace_back(chunk);
+    }
+    section.chunks = directory.chunks.size() - section.first_chunk;
+    directory.sections.emplace_back(section);
+  }
+  auto& chunks = directory.chunks;
+  vector<uint64_t> raw_offsets(chunks.size(), 0);
+  for (uint64_t c = 1; c < chunks.size(); ++c) {
+    raw_offsets[c] = raw_offsets[c-1] + chunks[c-1].raw_bytes;
+  }
+  vector<string> compressed(chunks.size());
+  bool ok = true;
+  #pragma omp parallel for num_threads(thread_count(threads)) schedule(dynamic, 1)
+  for (uint64_t c = 0; c < chunks.size(); ++c) {
+    compressed[c].resize(ZSTD_compressBound(chunks[c].raw_bytes));
+    size_t bytes = ZSTD_compress(&compressed[c][0], compressed[c].size(),
+                                 raw.data()+raw_offsets[c], chunks[c].raw_bytes, level);
+    if (ZSTD_isError(bytes)) {
+      #pragma omp critical
+      {
+        if (ok) {
+          cerr << "Could not compress: " << ZSTD_getErrorName(bytes) << endl;
+        }
+        ok = false;
+      }
+    } else {
+      compressed[c].resize(bytes);
+    }
+  }
+  if (!ok) {
+    return false;
+  }
+  uint64_t offset = 0;
+  for (uint64_t c = 0; c < chunks.size(); ++c) {
+    chunks[c].offset = offset;
+    chunks[c].bytes = compressed[c].size();
+    offset += chunks[c].bytes;
+  }
+  compressed_header& header = directory.header;
+  memcpy(header.magic, compressed_magic, sizeof(header.magic));
+  header.version = compressed_version;
+  header.profile = profile;
+  header.raw_bytes = raw.size();
+  header.sections = directory.sections.size();
+  header.chunks = chunks.size();
+  ofstream out(filename, std::ios::binary);
+  if (!out.is_open()) {
+    cerr << "Could not open '" << filename << "' for writing." << endl;
+    return false;
+  }
+  out.write((char*)&header, sizeof(header));
+  out.write((char*)directory.sections.data(), directory.sections.size()*sizeof(compressed_section));
+  out.write((char*)chunks.data(), chunks.size()*sizeof(compressed_chunk));
+  for (const auto& chunk : compressed) {
+    out.write(chunk.data(), chunk.size());
+  }
+  if (!out) {
+    cerr << "Something went wrong - storage didn't work as expected" << endl;
+    return false;
+  }
+  return true;
+}
+
+
+section_recorder::section_recorder(
+  const structure_tree_node& root,
+  vector<pair<string, uint64_t>>& sections) :
+  m_bytes(0), m_root(root), m_sections(sections) { }
+
+
+uint64_t section_recorder::bytes() const
+{
+  return m_bytes;
+}
+
+
+void section_recorder::record()
+{
+  if (m_root.children.size() != 1) {
+    return;
+  }
+  const structure_tree_node& graph = *m_root.children.begin()->second;
+  if (graph.children.size() == m_seen.size()) {
+    return;
+  }
+  for (const auto& child : graph.children) {
+    const string& name = child.second->name;
+    if (find(m_seen.begin(), m_seen.end(), name) == m_seen.end()) {
+      m_seen.emplace_back(name);
+      m_sections.emplace_back(name, m_bytes);
+    }
+  }
+}
+
+
+void section_recorder::finish()
+{
+  if (m_root.children.size() != 1) {
+    return;
+  }
+  const structure_tree_node& graph = *m_root.children.begin()->second;
+  auto size = [&](const string& name) {
+    for (const auto& child : graph.children) {
+      if (child.second->name == name) {
+        return (uint64_t)child.second->size;
+      }
+    }
+    return (uint64_t)0;
+  };
+  for (uint64_t s = 0; s < m_sections.size(); ++s) {
+    uint64_t end = s;
+    while (end+1 < m_sections.size() && m_sections[end+1].second == m_sections[s].second) {
+      ++end;
+    }
+    for (uint64_t t = s; t < end; ++t) {
+      if (size(m_sections[t].first) > 0) {
+        m_sections[t].swap(m_sections[end]);
+      }
+    }
+    s = end;
+  }
+}
+
+
+section_recorder::int_type section_recorder::overflow(int_type c)
+{
+  if (c != traits_type::eof()) {
+    record();
+    ++m_bytes;
+  }
+  return c;
+}
+
+
+std::streamsize section_recorder::xsputn(const char* s, std::streamsize n)
+{
+  record();
+  m_bytes += n;
+  return n;
+}
+
+
+string_buffer::string_buffer(string& data) : m_data(data) { }
+
+
+string_buffer::int_type string_buffer::overflow(int_type c)
+{
+  if (c != traits_type::eof()) {
+    m_data.push_back((char)c);
+  }
+  return c;
+}
+
+
+std::streamsize string_buffer::xsputn(const char* s, std::streamsize n)
+{
+  m_data.append(s, n);
+  return n;
+}
+
+
+section_reader::section_reader(const string& filename, uint64_t threads) :
+  m_filename(filename), m_threads(threads), m_data_offset(0), m_open(false), m_pos(0)
+{
+  if (!read_compressed_directory(filename, m_directory)) {
+    return;
+  }
+  const auto& sections = m_directory.sections;
+  const auto& chunks = m_directory.chunks;
+  uint64_t raw_offset = 0;
+  for (const auto& section : sections) {
+    uint64_t raw_bytes = 0;
+    for (uint64_t c = 0; c < section.chunks && section.first_chunk+c < chunks.size(); ++c) {
+      raw_bytes += chunks[section.first_chunk+c].raw_bytes;
+    }
+    if (section.raw_offset != raw_offset || section.raw_bytes != raw_bytes ||
+        section.first_chunk > chunks.size() || section.chunks > chunks.size()-section.first_chunk) {
+      cerr << "Graph '" << filename << "' has an inconsistent table of contents." << endl;
+      return;
+    }
+    raw_offset += raw_bytes;
+  }
+  if (raw_offset != m_directory.header.raw_bytes) {
+    cerr << "Graph '" << filename << "' has an inconsistent table of contents." << endl;
+    return;
+  }
+  m_data_offset = sizeof(compressed_header) +
+                  sections.size()*sizeof(compressed_section) +
+                  chunks.size()*sizeof(compressed_chunk);
+  m_in.open(filename, std::ios::binary | std::ios::ate);
+  if (!m_in.is_open()) {
+    cerr << "Could not open '" << filename << "' for reading." << endl;
+    return;
+  }
+  uint64_t data_bytes = (uint64_t)m_in.tellg() - m_data_offset;
+  for (const auto& chunk : chunks) {
+    if (chunk.offset > data_bytes || chunk.bytes > data_bytes-chunk.offset) {
+      cerr << "Graph '" << filename << "' is truncated." << endl;
+      return;
+    }
+  }
+  m_open = true;
+}
+
+
+bool section_reader::is_open() const
+{
+  return m_open;
+}
+
+
+uint64_t section_reader::section_of(uint64_t offset) const
+{
+  const auto& sections = m_directory.sections;
+  uint64_t s = 0;
+  while (s < sections.size() && sections[s].raw_offset+sections[s].raw_bytes <= offset) {
+    ++s;
+  }
+  return s;
+}
+
+
+bool section_reader::read_section(uint64_t s)
+{
+  string().swap(m_raw);
+  setg(nullptr, nullptr, nullptr);
+  const compressed_section& section = m_directory.sections[s];
+  const compressed_chunk* chunks = m_directory.chunks.data()+section.first_chunk;
+  uint64_t begin = chunks[0].offset;
+  uint64_t end = begin;
+  for (uint64_t c = 0; c < section.chunks; ++c) {
+    begin = min(begin, chunks[c].offset);
+    end = max(end, chunks[c].offset+chunks[c].bytes);
+  }
+  string data(end-begin, '\0');
+  m_in.clear();
+  m_in.seekg(m_data_offset+begin);
+  m_in.read(&data[0], data.size());
+  if (!m_in) {
+    cerr << "Graph '" << m_filename << "' is truncated." << endl;
+    return false;
+  }
+  vector<uint64_t> raw_offsets(section.chunks+1, 0);
+  for (uint64_t c = 0; c < section.chunks; ++c) {
+    raw_offsets[c+1] = raw_offsets[c] + chunks[c].raw_bytes;
+  }
+  m_raw.assign(section.raw_bytes, '\0');
+  bool ok = true;
+  #pragma omp parallel for num_threads(thread_count(m_threads)) schedule(dynamic, 1)
+  for (uint64_t c = 0; c < section.chunks; ++c) {
+    size_t bytes = ZSTD_decompress(&m_raw[raw_offsets[c]], chunks[c].raw_bytes,
+                                   &data[chunks[c].offset-begin], chunks[c].bytes);
+    if (ZSTD_isError(bytes) || bytes != chunks[c].raw_bytes) {
+      #pragma omp critical
+      {
+        if (ok) {
+          cerr << "Could not decompress chunk " << section.first_chunk+c;
+          cerr << " of '" << m_filename << "'";
+          if (ZSTD_isError(bytes)) {
+            cerr << ": " << ZSTD_getErrorName(bytes);
+          }
+          cerr << "." << endl;
+        }
+        ok = false;
+      }
+    }
+  }
+  if (!ok) {
+    string().swap(m_raw);
+    return false;
+  }
+  m_pos = section.raw_offset;
+  setg(&m_raw[0], &m_raw[0], &m_raw[0]+m_raw.size());
+  return true;
+}
+
+
+section_reader::int_type section_reader::underflow()
+{
+  if (gptr() < egptr()) {
+    return traits_type::to_int_type(*gptr());
+  }
+  if (!m_open) {
+    return traits_type::eof();
+  }
+  uint64_t offset = m_pos + (egptr()-eback());
+  uint64_t s = section_of(offset);
+  if (s == m_directory.sections.size() || !read_section(s)) {
+    m_pos = offset;
+    return traits_type::eof();
+  }
+  setg(eback(), eback()+(offset-m_pos), egptr());
+  return traits_type::to_int_type(*gptr());
+}
+
+
+section_reader::pos_type section_reader::seekoff(
+  off_type off,
+  std::ios_base::seekdir dir,
+  std::ios_base::openmode which)
+{
+  uint64_t current = m_pos + (gptr()-eback());
+  uint64_t target = current;
+  if (dir == std::ios_base::beg) {
+    target = 0;
+  } else if (dir == std::ios_base::end) {
+    target = m_directory.header.raw_bytes;
+  }
+  if (!(which & std::ios_base::in) || !m_open ||
+      (off < 0 && (uint64_t)-off > target) ||
+      (off > 0 && (uint64_t)off > m_directory.header.raw_bytes-target)) {
+    return pos_type(off_type(-1));
+  }
+  target += off;
+  if (target >= m_pos && target < m_pos+(egptr()-eback())) {
+    setg(eback(), eback()+(target-m_pos), egptr());
+  } else {
+    // The section of target is decompressed when it is read
+    string().swap(m_raw);
+    setg(nullptr, nullptr, nullptr);
+    m_pos = target;
+  }
+  return pos_type(off_type(target));
+}
+
+
+section_reader::pos_type section_reader::seekpos(pos_type pos, std::ios_base::openmode which)
+{
+  return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+
+}  // io
+}  // cdbg
@@ -0,0 +1,108 @@
+// std
+#include <cstring>  // memcmp
+#include <iostream>  // cerr, endl
+#include <string>
+// POSIX
+#include <fcntl.h>  // open
+#include <sys/mman.h>  // mmap, munmap
+#include <sys/stat.h>  // fstat
+#include <unistd.h>  // close
+// local
+#include "cdbg/io/explicit_stream.hpp"  // explicit_header, mapped_graph
+
+
+using std::cerr;
+using std::endl;
+using std::memcmp;
+using std::string;
+
+
+namespace cdbg {
+namespace io {
+
+
+mapped_graph::mapped_graph() :
+  m_file(nullptr),
+  m_file_size(0),
+  m_header(nullptr),
+  m_offsets(nullptr),
+  m_data(nullptr) { }
+
+
+mapped_graph::~mapped_graph()
+{
+  close();
+}
+
+
+bool mapped_graph::open(const string& filename, bool sequential)
+{
+  close();
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd == -1) {
+    cerr << "Could not open '" << filename << "' for reading." << endl;
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) == -1 || (uint64_t)st.st_size < sizeof(explicit_header)) {
+    cerr << "'" << filename << "' is not an explicit graph file." << endl;
+    ::close(fd);
+    return false;
+  }
+  void* file = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping stays valid after the descriptor is closed
+  ::close(fd);
+  if (file == MAP_FAILED) {
+    cerr << "Could not map '" << filename << "' into memory." << endl;
+    return false;
+  }
+  m_file = (const uint8_t*)file;
+  m_file_size = st.st_size;
+  m_header = (const explicit_header*)m_file;
+  uint64_t max_nodes = (m_file_size-sizeof(explicit_header))/sizeof(uint64_t);
+  bool valid = memcmp(m_header->magic, explicit_magic, sizeof(explicit_magic)) == 0 &&
+               m_header->version == explicit_version &&
+               m_header->nodes < max_nodes &&
+               m_header->data_bytes <= m_file_size &&
+               sizeof(explicit_header) + (m_header->nodes+1)*sizeof(uint64_t) +
+               m_header->data_bytes == m_file_size;
+  if (!valid) {
+    cerr << "'" << filename << "' is not an explicit graph file of version ";
+    cerr << explicit_version << "." << endl;
+    close();
+    return false;
+  }
+  m_offsets = (const uint64_t*)(m_file + sizeof(explicit_header));
+  m_data = (const uint8_t*)(m_offsets + m_header->nodes + 1);
+  // Records are decoded between consecutive offsets, which have to stay in
+  // the data section
+  uint64_t nodes = m_header->nodes;
+  bool ordered = m_offsets[0] == 0 && m_offsets[nodes] == m_header->data_bytes;
+  for (uint64_t i = 0; ordered && i < nodes; ++i) {
+    ordered = m_offsets[i] <= m_offsets[i+1];
+  }
+  if (!ordered) {
+    cerr << "'" << filename << "' has corrupt node offsets." << endl;
+    close();
+    return false;
+  }
+  madvise((void*)m_file, m_file_size, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+  return true;
+}
+
+
+void mapped_graph::close()
+{
+  if (m_file != nullptr) {
+    munmap((void*)m_file, m_file_size);
+  }
+  m_file = nullptr;
+  m_file_size = 0;
+  m_header = nullptr;
+  m_offsets = nullptr;
+  m_data = nullptr;
+}
+
+
+}  // io
+}  // cdbg
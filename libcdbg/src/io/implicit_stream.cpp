@@ -1,23 +1,124 @@
 // std
+#include <cstring>  // memcmp, memcpy
+#include <fstream>  // ifstream
+#include <iostream>  // cerr, endl, istream, ostream
+#include <stdexcept>  // runtime_error
 #include <string>
-// sdsl
-#include <sdsl/io.hpp>  // load_from_file
+#include <vector>
 // local
-#include "cdbg/cdbg.hpp"  // CDBG
+#include "cdbg/cdbg.hpp"  // CDBG, file_section, profile
+#include "cdbg/io/compressed_stream.hpp"  // compressed_directory, is_compressed,
+                                          // read_compressed_directory
+#include "cdbg/io/implicit_stream.hpp"  // implicit_header, implicit_section
 
 
+using std::cerr;
+using std::endl;
+using std::ifstream;
+using std::istream;
+using std::memcmp;
+using std::memcpy;
+using std::ostream;
+using std::runtime_error;
 using std::string;
+using std::vector;
 using cdbg::CDBG;
-using sdsl::load_from_file;
+using cdbg::profile;
 
 
 namespace cdbg {
 namespace io {
 
 
+// The profile that a header records as value
+static bool recorded_profile(uint64_t value, const string& filename, profile& p)
+{
+  for (const auto& candidate : profiles) {
+    if (value == (uint64_t)candidate) {
+      p = candidate;
+      return true;
+    }
+  }
+  cerr << "Graph '" << filename << "' has the unknown profile " << value;
+  cerr << "; it was written by a newer version of cdbg." << endl;
+  return false;
+}
+
+
+bool read_implicit_header(
+  istream& in,
+  const string& filename,
+  profile& p,
+  vector<file_section>* sections)
+{
+  if (sections != nullptr) {
+    sections->clear();
+  }
+  implicit_header header;
+  in.read((char*)&header, sizeof(header));
+  if (!in || memcmp(header.magic, implicit_magic, sizeof(header.magic)) != 0) {
+    // Files written before the header was added also store the node table
+    // differently, so they cannot be read either
+    cerr << "'" << filename << "' is not a graph file of a known format; ";
+    cerr << "rebuild the graph with the construct command." << endl;
+    return false;
+  }
+  if (header.version == 0 || header.version > implicit_version) {
+    cerr << "Graph '" << filename << "' has format version " << header.version;
+    cerr << ", expected at most " << implicit_version << "." << endl;
+    return false;
+  }
+  if (header.version >= 2) {
+    uint64_t count = 0;
+    in.read((char*)&count, sizeof(count));
+    vector<implicit_section> directory(count);
+    in.read((char*)directory.data(), count*sizeof(implicit_section));
+    if (!in) {
+      cerr << "Graph '" << filename << "' has a truncated section directory." << endl;
+      return false;
+    }
+    for (uint64_t s = 0; sections != nullptr && s < count; ++s) {
+      sections->push_back(file_section{directory[s].name, directory[s].offset, directory[s].bytes});
+    }
+  }
+  return recorded_profile(header.profile, filename, p);
+}
+
+
+void write_implicit_header(ostream& out, profile p, const vector<implicit_section>& sections)
+{
+  implicit_header header;
+  memcpy(header.magic, implicit_magic, sizeof(header.magic));
+  header.version = implicit_version;
+  header.profile = (uint64_t)p;
+  out.write((char*)&header, sizeof(header));
+  uint64_t count = sections.size();
+  out.write((char*)&count, sizeof(count));
+  out.write((char*)sections.data(), count*sizeof(implicit_section));
+}
+
+
+bool read_profile(const string& filename, profile& p)
+{
+  if (is_compressed(filename)) {
+    compressed_directory directory;
+    return read_compressed_directory(filename, directory) &&
+           recorded_profile(directory.header.profile, filename, p);
+  }
+  ifstream in(filename, std::ios::binary);
+  if (!in.is_open()) {
+    cerr << "Could not open '" << filename << "' for reading." << endl;
+    return false;
+  }
+  return read_implicit_header(in, filename, p);
+}
+
+
 CDBG load_implicit(const string& filename) {
   CDBG g;
-  load_from_file(g, filename);
+  if (!load_implicit(g, filename)) {
+    throw runtime_error("Could not load graph '" + filename + "'");
+  }
   return g;
 }
 
@@ -0,0 +1,199 @@
+// std
+#include <algorithm>  // max, sort
+#include <cstdio>  // sscanf
+#include <exception>  // exception
+#include <fstream>  // ifstream
+#include <initializer_list>
+#include <iostream>  // cerr, endl
+#include <sstream>  // istringstream
+#include <string>  // getline, stoull, string, to_string
+#include <thread>  // thread
+#include <vector>
+// sdsl
+#include <sdsl/memory_management.hpp>  // memory_manager
+// GNU
+#include <pthread.h>  // pthread_self, pthread_setaffinity_np
+#include <sched.h>  // CPU_SET, CPU_ZERO, cpu_set_t
+// POSIX
+#include <dirent.h>  // closedir, opendir, readdir
+#include <sys/mman.h>  // madvise
+#include <sys/stat.h>  // stat
+// local
+#include "cdbg/io/compressed_stream.hpp"  // compressed_directory, is_compressed,
+                                          // read_compressed_directory
+#include "cdbg/placement.hpp"  // page_mode
+
+
+using std::cerr;
+using std::endl;
+using std::exception;
+using std::getline;
+using std::ifstream;
+using std::istringstream;
+using std::max;
+using std::sort;
+using std::stoull;
+using std::string;
+using std::thread;
+using std::to_string;
+using std::vector;
+
+
+namespace cdbg {
+
+
+// Transparent huge pages are 2 MiB on x86-64
+const uint64_t huge_page_size = 1ULL << 21;
+
+
+string page_mode_name(page_mode mode)
+{
+  switch (mode) {
+    case page_mode::transparent:
+      return "transparent";
+    case page_mode::huge:
+      return "huge";
+    default:
+      return "normal";
+  }
+}
+
+
+bool parse_page_mode(const string& name, page_mode& mode)
+{
+  for (const auto& m : {page_mode::normal, page_mode::transparent, page_mode::huge}) {
+    if (name == page_mode_name(m)) {
+      mode = m;
+      return true;
+    }
+  }
+  return false;
+}
+
+
+// Parses a CPU list like "0-3,8-11"
+static vector<uint64_t> parse_cpu_list(const string& list)
+{
+  vector<uint64_t> cpus;
+  istringstream in(list);
+  string range;
+  while (getline(in, range, ',')) {
+    auto dash = range.find('-');
+    try {
+      uint64_t first = stoull(range.substr(0, dash));
+      uint64_t last = (dash == string::npos) ? first : stoull(range.substr(dash+1));
+      for (uint64_t cpu = first; cpu <= last; ++cpu) {
+        cpus.emplace_back(cpu);
+      }
+    } catch (...) { }
+  }
+  return cpus;
+}
+
+
+vector<vector<uint64_t>> numa_node_cpus()
+{
+  vector<vector<uint64_t>> nodes;
+  const string path = "/sys/devices/system/node";
+  DIR* dir = opendir(path.c_str());
+  if (dir != nullptr) {
+    vector<uint64_t> ids;
+    while (dirent* entry = readdir(dir)) {
+      string name = entry->d_name;
+      if (name.size() > 4 && name.compare(0, 4, "node") == 0 &&
+          name.find_first_not_of("0123456789", 4) == string::npos) {
+        ids.emplace_back(stoull(name.substr(4)));
+      }
+    }
+    closedir(dir);
+    sort(ids.begin(), ids.end());
+    for (const auto& id : ids) {
+      ifstream in(path + "/node" + to_string(id) + "/cpulist");
+      string list;
+      getline(in, list);
+      vector<uint64_t> cpus = parse_cpu_list(list);
+      // Nodes of memory only have no CPUs to bind to
+      if (!cpus.empty()) {
+        nodes.emplace_back(cpus);
+      }
+    }
+  }
+  if (nodes.empty()) {
+    nodes.emplace_back();
+    for (uint64_t cpu = 0; cpu < max(1u, thread::hardware_concurrency()); ++cpu) {
+      nodes.back().emplace_back(cpu);
+    }
+  }
+  return nodes;
+}
+
+
+bool bind_thread(const vector<uint64_t>& cpus)
+{
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (const auto& cpu : cpus) {
+    if (cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &set);
+    }
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+
+bool use_huge_pages(uint64_t bytes)
+{
+  try {
+    sdsl::memory_manager::use_hugepages(bytes);
+  } catch (const exception& e) {
+    cerr << "Could not map " << bytes << " bytes of huge pages (see ";
+    cerr << "vm.nr_hugepages): " << e.what() << endl;
+    return false;
+  }
+  return true;
+}
+
+
+uint64_t huge_page_pool_bytes(const string& filename, uint64_t copies)
+{
+  struct stat st;
+  uint64_t size = (stat(filename.c_str(), &st) == 0) ? st.st_size : 0;
+  io::compressed_directory directory;
+  if (io::is_compressed(filename) && io::read_compressed_directory(filename, directory)) {
+    size = directory.header.raw_bytes;
+  }
+  uint64_t bytes = copies*(size + size/4) + 16*huge_page_size;
+  return (bytes + huge_page_size-1) / huge_page_size * huge_page_size;
+}
+
+
+uint64_t advise_huge_pages()
+{
+  uint64_t advised = 0;
+  ifstream maps("/proc/self/maps");
+  string line;
+  while (getline(maps, line)) {
+    unsigned long begin, end, offset, inode;
+    char perms[5];
+    int path = 0;
+    if (sscanf(line.c_str(), "%lx-%lx %4s %lx %*s %lu %n",
+               &begin, &end, perms, &offset, &inode, &path) < 5) {
+      continue;
+    }
+    // Anonymous, writable memory: the heap and mmap'ed allocations
+    string name = line.substr(path);
+    if (perms[0] != 'r' || perms[1] != 'w' || inode != 0 ||
+        !(name.empty() || name == "[heap]")) {
+      continue;
+    }
+    uint64_t first = (begin + huge_page_size-1) / huge_page_size * huge_page_size;
+    uint64_t last = end / huge_page_size * huge_page_size;
+    if (first < last && madvise((void*)first, last-first, MADV_HUGEPAGE) == 0) {
+      advised += last-first;
+    }
+  }
+  return advised;
+}
+
+
+}  // cdbg
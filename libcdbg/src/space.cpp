@@ -0,0 +1,149 @@
+// std
+#include <fstream>  // ifstream
+#include <iomanip>  // fixed, setprecision
+#include <iostream>  // ostream
+#include <sstream>  // istringstream
+#include <string>  // getline, string
+// local
+#include "cdbg/space.hpp"  // space_node, space_report
+
+
+using std::fixed;
+using std::getline;
+using std::ifstream;
+using std::istringstream;
+using std::ostream;
+using std::setprecision;
+using std::string;
+
+
+namespace cdbg {
+
+
+uint64_t resident_memory()
+{
+  ifstream status("/proc/self/status");
+  string line;
+  while (getline(status, line)) {
+    if (line.compare(0, 6, "VmRSS:") == 0) {
+      istringstream in(line.substr(6));
+      uint64_t kib = 0;
+      in >> kib;
+      return kib << 10;
+    }
+  }
+  return 0;
+}
+
+
+static double bits_per_char(uint64_t bytes, uint64_t text_length)
+{
+  return text_length ? 8.0*bytes/text_length : 0.0;
+}
+
+
+static string json_escape(const string& s)
+{
+  string escaped;
+  for (const auto& c : s) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+    }
+    escaped += c;
+  }
+  return escaped;
+}
+
+
+static string html_escape(const string& s)
+{
+  string escaped;
+  for (const auto& c : s) {
+    switch (c) {
+      case '<':
+        escaped += "&lt;";
+        break;
+      case '>':
+        escaped += "&gt;";
+        break;
+      case '&':
+        escaped += "&amp;";
+        break;
+      default:
+        escaped += c;
+    }
+  }
+  return escaped;
+}
+
+
+static void write_json_node(const space_node& node, uint64_t text_length, const string& indent, ostream& out)
+{
+  out << indent << "{\"name\": \"" << json_escape(node.name) << "\", ";
+  out << "\"type\": \"" << json_escape(node.type) << "\", ";
+  out << "\"bytes\": " << node.bytes << ", ";
+  out << "\"bits_per_char\": " << bits_per_char(node.bytes, text_length);
+  if (!node.children.empty()) {
+    out << ", \"components\": [\n";
+    for (uint64_t i = 0; i < node.children.size(); ++i) {
+      write_json_node(node.children[i], text_length, indent+"  ", out);
+      out << (i+1 < node.children.size() ? ",\n" : "\n");
+    }
+    out << indent << "]";
+  }
+  out << "}";
+}
+
+
+void write_space_json(const space_report& report, ostream& out)
+{
+  out << fixed << setprecision(4);
+  out << "{\n";
+  out << "  \"graph\": \"" << json_escape(report.graph) << "\",\n";
+  out << "  \"profile\": \"" << report.profile << "\",\n";
+  out << "  \"text_length\": " << report.text_length << ",\n";
+  out << "  \"bytes\": " << report.root.bytes << ",\n";
+  out << "  \"bits_per_char\": " << bits_per_char(report.root.bytes, report.text_length) << ",\n";
+  out << "  \"resident_bytes\": " << report.resident_after << ",\n";
+  out << "  \"resident_bytes_of_graph\": ";
+  out << (report.resident_after > report.resident_before ? report.resident_after-report.resident_before : 0) << ",\n";
+  out << "  \"components\": [\n";
+  for (uint64_t i = 0; i < report.root.children.size(); ++i) {
+    write_json_node(report.root.children[i], report.text_length, "    ", out);
+    out << (i+1 < report.root.children.size() ? ",\n" : "\n");
+  }
+  out << "  ]\n";
+  out << "}\n";
+}
+
+
+static void write_html_node(const space_node& node, uint64_t total, uint64_t text_length, uint64_t depth, ostream& out)
+{
+  double percent = total ? 100.0*node.bytes/total : 0.0;
+  out << "<tr><td style=\"padding-left:" << 1.5*depth << "em\">" << html_escape(node.name) << "</td>";
+  out << "<td>" << node.bytes << "</td>";
+  out << "<td>" << bits_per_char(node.bytes, text_length) << "</td>";
+  out << "<td><div style=\"background:#4a7;height:1em;width:" << percent << "%\"></div></td>";
+  out << "<td><code>" << html_escape(node.type) << "</code></td></tr>\n";
+  for (const auto& child : node.children) {
+    write_html_node(child, total, text_length, depth+1, out);
+  }
+}
+
+
+void write_space_html(const space_report& report, ostream& out)
+{
+  out << fixed << setprecision(4);
+  out << "<!DOCTYPE html>\n<html>\n<head><meta charset=\"utf-8\"><title>";
+  out << html_escape(report.graph) << "</title></head>\n<body>\n";
+  out << "<h1>" << html_escape(report.graph) << "</h1>\n";
+  out << "<p>Profile " << report.profile << ", " << report.text_length << " characters, ";
+  out << report.root.bytes << " bytes (" << bits_per_char(report.root.bytes, report.text_length);
+  out << " bits per character), " << report.resident_after << " bytes resident after loading.</p>\n";
+  out << "<table>\n<tr><th>component</th><th>bytes</th><th>bits/char</th><th>share</th><th>type</th></tr>\n";
+  write_html_node(report.root, report.root.bytes, report.text_length, 0, out);
+  out << "</table>\n</body>\n</html>\n";
+}
+
+
+}  // cdbg